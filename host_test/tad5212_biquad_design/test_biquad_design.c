@@ -0,0 +1,159 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Host test of the integer biquad designer: magnitude response of the designed coefficients, and
+ * linear amplitude of gains in dB
+ *
+ * No licence
+ */
+
+/*** Includes ***********************************************************************/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "tad5212_biquad_design.h"
+
+/*** Defines ***********************************************************************/
+
+/* Allowed error on a magnitude, in dB */
+#define TOLERANCE_DB    0.05
+
+/*** Static variables ***********************************************************************/
+
+static const uint32_t s_sample_rates[] = { 32000, 44100, 48000 };
+
+static int s_failures = 0;
+
+/*** Static functions ***********************************************************************/
+
+/**
+ * \brief Magnitude response of codec coefficients.
+ * \param coeffs Coefficients, in the codec format.
+ * \param freq Frequency in Hz.
+ * \param sample_rate Sample rate in Hz.
+ * \return |H(e^jw)| in dB.
+ */
+static double magnitude_db(const tad5212_biquad_coeffs_t* coeffs, double freq, uint32_t sample_rate)
+{
+    double n0 = (int32_t)coeffs->n0.value / 2147483648.0;
+    double n1 = 2.0 * (int32_t)coeffs->n1.value / 2147483648.0;
+    double n2 = (int32_t)coeffs->n2.value / 2147483648.0;
+    double d1 = -2.0 * (int32_t)coeffs->d1.value / 2147483648.0;
+    double d2 = -(int32_t)coeffs->d2.value / 2147483648.0;
+    double w = 2.0 * M_PI * freq / sample_rate;
+
+    /* H(z) = (n0 + n1.z^-1 + n2.z^-2) / (1 + d1.z^-1 + d2.z^-2) on the unit circle */
+    double num_re = n0 + n1 * cos(w) + n2 * cos(2 * w);
+    double num_im = -n1 * sin(w) - n2 * sin(2 * w);
+    double den_re = 1.0 + d1 * cos(w) + d2 * cos(2 * w);
+    double den_im = -d1 * sin(w) - d2 * sin(2 * w);
+
+    return 10.0 * log10((num_re * num_re + num_im * num_im) / (den_re * den_re + den_im * den_im));
+}
+
+
+/**
+ * \brief Design a filter and check its magnitude at two frequencies.
+ * \param type Filter response.
+ * \param freq_hz Corner or center frequency.
+ * \param q Quality factor, in thousandths.
+ * \param gain Gain, in tenths of dB.
+ * \param probe_a First probe frequency in Hz, 0 for DC.
+ * \param expect_a Expected magnitude at probe_a, in dB.
+ * \param probe_b Second probe frequency in Hz, negative for Nyquist.
+ * \param expect_b Expected magnitude at probe_b, in dB.
+ */
+static void check(tad5212_biquad_type_t type, uint32_t freq_hz, uint32_t q, int32_t gain,
+                  double probe_a, double expect_a, double probe_b, double expect_b)
+{
+    tad5212_biquad_spec_t spec = { type, freq_hz, q, gain };
+    tad5212_biquad_coeffs_t coeffs;
+
+    for (size_t i = 0; i < sizeof(s_sample_rates) / sizeof(s_sample_rates[0]); i++)
+    {
+        uint32_t rate = s_sample_rates[i];
+        double fb = (probe_b < 0) ? rate / 2.0 : probe_b;
+        esp_err_t status = tad5212_biquad_design(&spec, rate, &coeffs);
+        double mag_a, mag_b;
+
+        if (status != ESP_OK)
+        {
+            printf("FAIL type %d %u Hz gain %d at %u Hz: design error 0x%x\n", type, (unsigned)freq_hz,
+                   (int)gain, (unsigned)rate, status);
+            s_failures++;
+            continue;
+        }
+
+        mag_a = magnitude_db(&coeffs, probe_a, rate);
+        mag_b = magnitude_db(&coeffs, fb, rate);
+
+        if (fabs(mag_a - expect_a) > TOLERANCE_DB || fabs(mag_b - expect_b) > TOLERANCE_DB)
+        {
+            printf("FAIL type %d %u Hz gain %d at %u Hz: %.3f dB at %.0f Hz (expected %.1f), "
+                   "%.3f dB at %.0f Hz (expected %.1f)\n", type, (unsigned)freq_hz, (int)gain, (unsigned)rate,
+                   mag_a, probe_a, expect_a, mag_b, fb, expect_b);
+            s_failures++;
+        }
+    }
+}
+
+
+/**
+ * \brief Check the linear amplitude of gains against the floating point value, and the Q1.14
+ *        mixer coefficients derived from it.
+ */
+static void check_gains(void)
+{
+    for (int32_t gain = -TAD5212_DB_GAIN_MAX; gain <= TAD5212_DB_GAIN_MAX; gain++)
+    {
+        double expected = pow(10.0, gain / 200.0);
+        double linear = tad5212_db_to_gain_q32(gain) / 4294967296.0;
+        long coeff = (long)((tad5212_db_to_gain_q32(gain) + (1LL << 17)) >> 18);
+
+        if (fabs(linear - expected) > expected * 1e-6 + 1.0 / 4294967296.0 ||
+            (gain >= -720 && gain <= 60 && labs(coeff - lround(16384.0 * expected)) > 1))
+        {
+            printf("FAIL gain %d: %.9f (expected %.9f), mixer coefficient %ld\n", (int)gain, linear, expected, coeff);
+            s_failures++;
+        }
+    }
+}
+
+/*** Main ***********************************************************************/
+
+int main(void)
+{
+    /* Built-in EQ profiles (tad5212_eq.c): Bass, Vocal and Treble, full gain at every rate */
+    check(TAD5212_BIQUAD_TYPE_LOW_SHELF, 120, TAD5212_BIQUAD_Q_BUTTERWORTH, 60, 0, 0.0, -1, -6.0);
+    check(TAD5212_BIQUAD_TYPE_PEAKING, 2500, 1000, 30, 2500, 0.0, 0, -3.0);
+    check(TAD5212_BIQUAD_TYPE_HIGH_SHELF, 6000, TAD5212_BIQUAD_Q_BUTTERWORTH, 40, 0, -4.0, -1, 0.0);
+
+    /* Boosts peak at 0 dB, the rest of the band cut by the gain */
+    check(TAD5212_BIQUAD_TYPE_HIGH_SHELF, 6000, TAD5212_BIQUAD_Q_BUTTERWORTH, 10, 0, -1.0, -1, 0.0);
+    check(TAD5212_BIQUAD_TYPE_HIGH_SHELF, 2000, TAD5212_BIQUAD_Q_BUTTERWORTH, 40, 0, -4.0, -1, 0.0);
+    check(TAD5212_BIQUAD_TYPE_PEAKING, 1000, 1000, 120, 1000, 0.0, 0, -12.0);
+
+    /* Cuts keep the pass band at 0 dB */
+    check(TAD5212_BIQUAD_TYPE_LOW_SHELF, 200, TAD5212_BIQUAD_Q_BUTTERWORTH, -60, 0, -6.0, -1, 0.0);
+    check(TAD5212_BIQUAD_TYPE_HIGH_SHELF, 4000, TAD5212_BIQUAD_Q_BUTTERWORTH, -60, 0, 0.0, -1, -6.0);
+    check(TAD5212_BIQUAD_TYPE_PEAKING, 1000, 2000, -120, 1000, -12.0, 0, 0.0);
+
+    /* Crossover responses, -3 dB at the corner */
+    check(TAD5212_BIQUAD_TYPE_LOWPASS, 2000, TAD5212_BIQUAD_Q_BUTTERWORTH, 0, 0, 0.0, 2000, -3.01);
+    check(TAD5212_BIQUAD_TYPE_HIGHPASS, 2000, TAD5212_BIQUAD_Q_BUTTERWORTH, 0, 15000, 0.0, 2000, -3.01);
+
+    /* Linear gains, mixer range of -72 dB to +6 dB included */
+    check_gains();
+
+    if (s_failures != 0)
+    {
+        printf("%d check(s) failed\n", s_failures);
+        return 1;
+    }
+
+    printf("All checks passed\n");
+    return 0;
+}
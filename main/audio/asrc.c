@@ -0,0 +1,164 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Asynchronous sample-rate converter absorbing the clock drift between
+ * the A2DP source and the local I2S clock
+ * 
+ * No licence
+ */
+
+#include <string.h>
+
+#include "asrc.h"
+
+/*** Defines *********************************************************************/
+
+/* 1.0 in Q32.32 */
+#define ASRC_ONE                (1ULL << 32)
+
+/* Q32 ratio units per ppm, 2^32 / 10^6 */
+#define ASRC_UNITS_PER_PPM      (4295)
+
+/* fill level low-pass filter, new = old + (in - old) / 2^shift */
+#define ASRC_FILL_FILTER_SHIFT  (5)
+
+/* controller gains in Q16 ppm per frame of error: 0.1 ppm proportional, ~1e-4 ppm integral per update */
+#define ASRC_KP_Q16             (6554)
+#define ASRC_KI_Q16             (6)
+
+/*** Static functions ************************************************************/
+
+/**
+ * \brief Catmull-Rom cubic interpolation between x1 and x2.
+ * \param x0 Sample before x1.
+ * \param x1 Sample at t = 0.
+ * \param x2 Sample at t = 1.
+ * \param x3 Sample after x2.
+ * \param t Q16 position between x1 and x2.
+ * \return Interpolated sample, saturated to 16 bits.
+ */
+static int16_t asrc_interpolate(int32_t x0, int32_t x1, int32_t x2, int32_t x3, int64_t t)
+{
+    int64_t acc = 3 * (x1 - x2) + x3 - x0;
+
+    acc = ((acc * t) >> 16) + (2 * x0 - 5 * x1 + 4 * x2 - x3);
+    acc = ((acc * t) >> 16) + (x2 - x0);
+    acc = ((acc * t) >> 17) + x1;
+
+    if (acc > INT16_MAX)
+    {
+        return INT16_MAX;
+    }
+    if (acc < INT16_MIN)
+    {
+        return INT16_MIN;
+    }
+    return (int16_t)acc;
+}
+
+/*** Extern functions ************************************************************/
+
+/**
+ * \brief Reset the converter to a unity ratio and clear its history.
+ * \param asrc Pointer to the converter.
+ * \param channels Number of interleaved 16-bit channels (1 or 2).
+ */
+void asrc_init(asrc_t* asrc, uint8_t channels)
+{
+    memset(asrc, 0, sizeof(asrc_t));
+
+    asrc->channels = (channels > ASRC_MAX_CHANNELS) ? ASRC_MAX_CHANNELS : channels;
+    asrc->step = ASRC_ONE;
+}
+
+/**
+ * \brief Run one step of the PI controller keeping the buffer fill level on target.
+ *        A fill level above the target speeds up the consumption of input frames.
+ * \param asrc Pointer to the converter.
+ * \param fill_frames Frames currently waiting in the buffer feeding the converter.
+ * \param target_frames Fill level the buffer should be kept at.
+ * \return The ratio correction now applied, in ppm.
+ */
+int32_t asrc_update(asrc_t* asrc, int32_t fill_frames, int32_t target_frames)
+{
+    const int32_t limit = ASRC_MAX_PPM << 16;
+    int32_t error;
+    int32_t ppm;
+
+    /* packets arrive in bursts, only the slow trend of the fill level is relevant */
+    if (!asrc->controller_primed)
+    {
+        asrc->fill_filtered = fill_frames << 8;
+        asrc->controller_primed = true;
+    }
+    else
+    {
+        asrc->fill_filtered += ((fill_frames << 8) - asrc->fill_filtered) >> ASRC_FILL_FILTER_SHIFT;
+    }
+    error = (asrc->fill_filtered >> 8) - target_frames;
+
+    /* integral term holds the steady clock drift, clamped against windup */
+    asrc->integral += error * ASRC_KI_Q16;
+    if (asrc->integral > limit)
+    {
+        asrc->integral = limit;
+    }
+    else if (asrc->integral < -limit)
+    {
+        asrc->integral = -limit;
+    }
+
+    ppm = error * ASRC_KP_Q16 + asrc->integral;
+    if (ppm > limit)
+    {
+        ppm = limit;
+    }
+    else if (ppm < -limit)
+    {
+        ppm = -limit;
+    }
+
+    asrc->step = ASRC_ONE + (((int64_t)ppm * ASRC_UNITS_PER_PPM) >> 16);
+
+    return ppm >> 16;
+}
+
+/**
+ * \brief Resample a block of interleaved 16-bit frames.
+ * \param asrc Pointer to the converter.
+ * \param in Input frames.
+ * \param in_frames Number of input frames.
+ * \param out Output frames, room for in_frames + ASRC_MAX_EXTRA_FRAMES frames.
+ * \return Number of output frames written.
+ */
+size_t asrc_process(asrc_t* asrc, const int16_t* in, size_t in_frames, int16_t* out)
+{
+    int16_t (*h)[ASRC_MAX_CHANNELS] = asrc->history;
+    size_t out_frames = 0;
+
+    for (size_t i = 0; i < in_frames; i++)
+    {
+        /* slide the 4-frame window by one input frame */
+        memmove(&h[0], &h[1], 3 * sizeof(h[0]));
+        for (uint8_t c = 0; c < asrc->channels; c++)
+        {
+            h[3][c] = *in++;
+        }
+
+        /* emit every output frame falling between h[1] and h[2] */
+        while (asrc->phase < ASRC_ONE)
+        {
+            int64_t t = (int64_t)(asrc->phase >> 16);
+
+            for (uint8_t c = 0; c < asrc->channels; c++)
+            {
+                *out++ = asrc_interpolate(h[0][c], h[1][c], h[2][c], h[3][c], t);
+            }
+            out_frames++;
+            asrc->phase += asrc->step;
+        }
+        asrc->phase -= ASRC_ONE;
+    }
+
+    return out_frames;
+}
@@ -0,0 +1,79 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Asynchronous sample-rate converter absorbing the clock drift between
+ * the A2DP source and the local I2S clock
+ * 
+ * No licence
+ */
+
+#ifndef __ASRC_H__
+#define __ASRC_H__
+
+/*** Includes ********************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+
+/*** Defines *********************************************************************/
+
+/* log tag */
+#define ASRC_TAG                "ASRC"
+
+/* maximum number of interleaved channels */
+#define ASRC_MAX_CHANNELS       (2)
+
+/* maximum ratio correction, in ppm, applied by the fill level controller */
+#define ASRC_MAX_PPM            (CONFIG_EXAMPLE_A2DP_SINK_ASRC_MAX_PPM)
+
+/* extra output frames produced at most per input block, on top of the input frame count */
+#define ASRC_MAX_EXTRA_FRAMES   (2)
+
+/*** Structures ******************************************************************/
+
+typedef struct
+{
+    uint8_t channels;                               /* interleaved channels, 1 or 2 */
+    uint64_t phase;                                 /* Q32.32 position of the next output frame */
+    uint64_t step;                                  /* Q32.32 input frames consumed per output frame */
+    int16_t history[4][ASRC_MAX_CHANNELS];          /* last input frames, oldest first */
+
+    int32_t fill_filtered;                          /* Q8 low-pass filtered fill level, in frames */
+    int32_t integral;                               /* Q16 integral term of the controller, in ppm */
+    bool controller_primed;                         /* fill_filtered holds a valid value */
+}
+asrc_t;
+
+/*** Extern functions ************************************************************/
+
+/**
+ * \brief Reset the converter to a unity ratio and clear its history.
+ * \param asrc Pointer to the converter.
+ * \param channels Number of interleaved 16-bit channels (1 or 2).
+ */
+void asrc_init(asrc_t* asrc, uint8_t channels);
+
+/**
+ * \brief Run one step of the PI controller keeping the buffer fill level on target.
+ *        A fill level above the target speeds up the consumption of input frames.
+ * \param asrc Pointer to the converter.
+ * \param fill_frames Frames currently waiting in the buffer feeding the converter.
+ * \param target_frames Fill level the buffer should be kept at.
+ * \return The ratio correction now applied, in ppm.
+ */
+int32_t asrc_update(asrc_t* asrc, int32_t fill_frames, int32_t target_frames);
+
+/**
+ * \brief Resample a block of interleaved 16-bit frames.
+ * \param asrc Pointer to the converter.
+ * \param in Input frames.
+ * \param in_frames Number of input frames.
+ * \param out Output frames, room for in_frames + ASRC_MAX_EXTRA_FRAMES frames.
+ * \return Number of output frames written.
+ */
+size_t asrc_process(asrc_t* asrc, const int16_t* in, size_t in_frames, int16_t* out);
+
+#endif /* __ASRC_H__ */
@@ -0,0 +1,143 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Packet-loss concealment bridging short gaps of the audio stream
+ * 
+ * No licence
+ */
+
+#include <string.h>
+
+#include "plc.h"
+
+/*** Defines *********************************************************************/
+
+/* 1.0 in Q15 */
+#define PLC_UNITY_GAIN          (1 << 15)
+
+/*** Static functions ************************************************************/
+
+/**
+ * \brief Produce the next concealment frame and advance the replay position.
+ * \param plc Pointer to the concealment state.
+ * \param out Output frame.
+ */
+static void plc_next_frame(plc_t* plc, int16_t* out)
+{
+    if (plc->history_frames == 0 || plc->gain <= 0)
+    {
+        memset(out, 0, plc->channels * sizeof(int16_t));
+        return;
+    }
+
+    for (uint8_t c = 0; c < plc->channels; c++)
+    {
+        out[c] = (int16_t)((plc->history[plc->position][c] * plc->gain) >> 15);
+    }
+
+    /* bounce on both ends of the history, the replayed waveform stays continuous */
+    if ((plc->direction > 0 && plc->position + 1 >= plc->history_frames) ||
+        (plc->direction < 0 && plc->position == 0))
+    {
+        plc->direction = -plc->direction;
+    }
+    else
+    {
+        plc->position += plc->direction;
+    }
+
+    plc->gain -= PLC_UNITY_GAIN / PLC_FADE_OUT_FRAMES;
+}
+
+/*** Extern functions ************************************************************/
+
+/**
+ * \brief Reset the concealment state and forget the history.
+ * \param plc Pointer to the concealment state.
+ * \param channels Number of interleaved 16-bit channels (1 or 2).
+ */
+void plc_init(plc_t* plc, uint8_t channels)
+{
+    memset(plc, 0, sizeof(plc_t));
+
+    plc->channels = (channels > PLC_MAX_CHANNELS) ? PLC_MAX_CHANNELS : channels;
+}
+
+/**
+ * \brief Keep the tail of a block about to be played as concealment material.
+ * \param plc Pointer to the concealment state.
+ * \param pcm Interleaved 16-bit frames.
+ * \param frames Number of frames.
+ */
+void plc_record(plc_t* plc, const int16_t* pcm, size_t frames)
+{
+    if (frames > PLC_HISTORY_FRAMES)
+    {
+        pcm += (frames - PLC_HISTORY_FRAMES) * plc->channels;
+        frames = PLC_HISTORY_FRAMES;
+    }
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        for (uint8_t c = 0; c < plc->channels; c++)
+        {
+            plc->history[i][c] = *pcm++;
+        }
+    }
+    plc->history_frames = frames;
+}
+
+/**
+ * \brief Synthesize frames replacing missing audio. The last played frames are replayed
+ *        back and forth, so that no discontinuity is created, under a fade-out to silence.
+ * \param plc Pointer to the concealment state.
+ * \param out Interleaved 16-bit output frames.
+ * \param frames Number of frames to synthesize.
+ */
+void plc_conceal(plc_t* plc, int16_t* out, size_t frames)
+{
+    /* start from the last played frame, going backwards */
+    if (plc->concealed_frames == 0)
+    {
+        plc->position = (plc->history_frames > 0) ? plc->history_frames - 1 : 0;
+        plc->direction = -1;
+        plc->gain = PLC_UNITY_GAIN;
+    }
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        plc_next_frame(plc, out);
+        out += plc->channels;
+    }
+    plc->concealed_frames += frames;
+}
+
+/**
+ * \brief Crossfade the concealment signal into the first block of recovered audio.
+ *        Does nothing when no frame was concealed since the last call.
+ * \param plc Pointer to the concealment state.
+ * \param pcm Interleaved 16-bit frames, modified in place.
+ * \param frames Number of frames.
+ */
+void plc_resume(plc_t* plc, int16_t* pcm, size_t frames)
+{
+    int16_t concealed[PLC_MAX_CHANNELS];
+
+    if (plc->concealed_frames == 0 || frames == 0)
+    {
+        return;
+    }
+
+    for (size_t i = 0; i < frames; i++)
+    {
+        int32_t ramp = (int32_t)((i * PLC_UNITY_GAIN) / frames);
+
+        plc_next_frame(plc, concealed);
+        for (uint8_t c = 0; c < plc->channels; c++)
+        {
+            pcm[c] = (int16_t)((pcm[c] * ramp + concealed[c] * (PLC_UNITY_GAIN - ramp)) >> 15);
+        }
+        pcm += plc->channels;
+    }
+    plc->concealed_frames = 0;
+}
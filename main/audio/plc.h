@@ -0,0 +1,81 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Packet-loss concealment bridging short gaps of the audio stream
+ * 
+ * No licence
+ */
+
+#ifndef __PLC_H__
+#define __PLC_H__
+
+/*** Includes ********************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+/*** Defines *********************************************************************/
+
+/* log tag */
+#define PLC_TAG                 "PLC"
+
+/* maximum number of interleaved channels */
+#define PLC_MAX_CHANNELS        (2)
+
+/* last played frames kept to synthesize the concealment signal */
+#define PLC_HISTORY_FRAMES      (240)
+
+/* length of the concealment fade-out, then silence */
+#define PLC_FADE_OUT_FRAMES     (480)
+
+/*** Structures ******************************************************************/
+
+typedef struct
+{
+    uint8_t channels;                                       /* interleaved channels, 1 or 2 */
+    int16_t history[PLC_HISTORY_FRAMES][PLC_MAX_CHANNELS];  /* last played frames */
+    size_t history_frames;                                  /* valid frames in history */
+
+    size_t position;                                        /* next history frame replayed */
+    int8_t direction;                                       /* replay direction, +1 or -1 */
+    int32_t gain;                                           /* Q15 gain of the concealment signal */
+    uint32_t concealed_frames;                              /* frames synthesized since the loss */
+}
+plc_t;
+
+/*** Extern functions ************************************************************/
+
+/**
+ * \brief Reset the concealment state and forget the history.
+ * \param plc Pointer to the concealment state.
+ * \param channels Number of interleaved 16-bit channels (1 or 2).
+ */
+void plc_init(plc_t* plc, uint8_t channels);
+
+/**
+ * \brief Keep the tail of a block about to be played as concealment material.
+ * \param plc Pointer to the concealment state.
+ * \param pcm Interleaved 16-bit frames.
+ * \param frames Number of frames.
+ */
+void plc_record(plc_t* plc, const int16_t* pcm, size_t frames);
+
+/**
+ * \brief Synthesize frames replacing missing audio. The last played frames are replayed
+ *        back and forth, so that no discontinuity is created, under a fade-out to silence.
+ * \param plc Pointer to the concealment state.
+ * \param out Interleaved 16-bit output frames.
+ * \param frames Number of frames to synthesize.
+ */
+void plc_conceal(plc_t* plc, int16_t* out, size_t frames);
+
+/**
+ * \brief Crossfade the concealment signal into the first block of recovered audio.
+ *        Does nothing when no frame was concealed since the last call.
+ * \param plc Pointer to the concealment state.
+ * \param pcm Interleaved 16-bit frames, modified in place.
+ * \param frames Number of frames.
+ */
+void plc_resume(plc_t* plc, int16_t* pcm, size_t frames);
+
+#endif /* __PLC_H__ */
@@ -0,0 +1,233 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Lock-free telemetry of the audio pipeline (counters and histograms)
+ * 
+ * No licence
+ */
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "telemetry.h"
+
+/*** Defines *********************************************************************/
+
+/* stack of the summary task, one line is formatted at a time */
+#define TELEMETRY_TASK_STACK_SIZE   (3072)
+
+/*** Static variables ************************************************************/
+
+static atomic_uint_fast32_t s_counters[TELEMETRY_CNT_NUM];
+static atomic_uint_fast32_t s_hist[TELEMETRY_HIST_NUM][TELEMETRY_HIST_BUCKETS];
+
+static esp_timer_handle_t s_summary_timer = NULL;
+static TaskHandle_t s_task_handle = NULL;
+
+static const char* s_counter_names[TELEMETRY_CNT_NUM] =
+{
+    [TELEMETRY_CNT_PACKETS]             = "pkt",
+    [TELEMETRY_CNT_BYTES]               = "bytes",
+    [TELEMETRY_CNT_PACKETS_DROPPED]     = "pkt_drop",
+    [TELEMETRY_CNT_FRAMES_TRIMMED]      = "trimmed",
+    [TELEMETRY_CNT_OVERFLOWS]           = "ovf",
+    [TELEMETRY_CNT_UNDERFLOWS]          = "udf",
+    [TELEMETRY_CNT_FRAMES_CONCEALED]    = "concealed",
+    [TELEMETRY_CNT_PREFETCH_RESTARTS]   = "prefetch",
+    [TELEMETRY_CNT_DEADLINE_MISSES]     = "late",
+};
+
+static const char* s_hist_names[TELEMETRY_HIST_NUM] =
+{
+    [TELEMETRY_HIST_FILL_WRITE]         = "fill_wr/16",
+    [TELEMETRY_HIST_FILL_READ]          = "fill_rd/16",
+    [TELEMETRY_HIST_QUEUE_MS]           = "queue_log2ms",
+    [TELEMETRY_HIST_UNDERFLOW_MS]       = "udf_log2ms",
+    [TELEMETRY_HIST_OVERFLOW_MS]        = "ovf_log2ms",
+    [TELEMETRY_HIST_I2S_WRITE_US]       = "i2s_log2us",
+};
+
+/*** Static functions ************************************************************/
+
+/**
+ * \brief Periodic summary callback. Runs in the esp_timer task: only wakes the summary task up.
+ * \param arg Unused.
+ */
+static void telemetry_summary_cb(void* arg)
+{
+    xTaskNotifyGive(s_task_handle);
+}
+
+/**
+ * \brief Summary task: format and print the summary at low priority.
+ * \param arg Unused.
+ */
+static void telemetry_task(void* arg)
+{
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        telemetry_log_summary();
+    }
+}
+
+/*** Extern functions ************************************************************/
+
+/**
+ * \brief Add to a counter. Safe from any task, constant time.
+ * \param counter Counter to increment.
+ * \param n Amount added.
+ */
+void telemetry_count(telemetry_counter_t counter, uint32_t n)
+{
+    atomic_fetch_add_explicit(&s_counters[counter], n, memory_order_relaxed);
+}
+
+/**
+ * \brief Record a value in a histogram with power of two buckets: bucket 0 holds 0,
+ *        bucket n holds [2^(n-1), 2^n[, the last bucket holds everything above.
+ * \param hist Histogram to update.
+ * \param value Value in the unit of the histogram.
+ */
+void telemetry_record(telemetry_hist_t hist, uint32_t value)
+{
+    uint32_t bucket = (value == 0) ? 0 : 32 - __builtin_clz(value);
+
+    if (bucket >= TELEMETRY_HIST_BUCKETS)
+    {
+        bucket = TELEMETRY_HIST_BUCKETS - 1;
+    }
+    atomic_fetch_add_explicit(&s_hist[hist][bucket], 1, memory_order_relaxed);
+}
+
+/**
+ * \brief Record a fill level in a histogram with linear buckets.
+ * \param hist Histogram to update.
+ * \param level Current fill level.
+ * \param capacity Fill level of a full buffer.
+ */
+void telemetry_record_fill(telemetry_hist_t hist, size_t level, size_t capacity)
+{
+    uint32_t bucket = (capacity == 0) ? 0 : (uint32_t)(level * TELEMETRY_HIST_BUCKETS / capacity);
+
+    if (bucket >= TELEMETRY_HIST_BUCKETS)
+    {
+        bucket = TELEMETRY_HIST_BUCKETS - 1;
+    }
+    atomic_fetch_add_explicit(&s_hist[hist][bucket], 1, memory_order_relaxed);
+}
+
+/**
+ * \brief Copy every counter and histogram.
+ * \param snapshot Destination of the copy.
+ */
+void telemetry_snapshot(telemetry_snapshot_t* snapshot)
+{
+    for (int i = 0; i < TELEMETRY_CNT_NUM; i++)
+    {
+        snapshot->counters[i] = atomic_load_explicit(&s_counters[i], memory_order_relaxed);
+    }
+    for (int h = 0; h < TELEMETRY_HIST_NUM; h++)
+    {
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++)
+        {
+            snapshot->hist[h][b] = atomic_load_explicit(&s_hist[h][b], memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * \brief Clear every counter and histogram.
+ */
+void telemetry_reset(void)
+{
+    for (int i = 0; i < TELEMETRY_CNT_NUM; i++)
+    {
+        atomic_store_explicit(&s_counters[i], 0, memory_order_relaxed);
+    }
+    for (int h = 0; h < TELEMETRY_HIST_NUM; h++)
+    {
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS; b++)
+        {
+            atomic_store_explicit(&s_hist[h][b], 0, memory_order_relaxed);
+        }
+    }
+}
+
+/**
+ * \brief Log a compact summary of the counters and histograms.
+ */
+void telemetry_log_summary(void)
+{
+    static telemetry_snapshot_t snapshot;
+    char line[160];
+    int len = 0;
+
+    telemetry_snapshot(&snapshot);
+
+    for (int i = 0; i < TELEMETRY_CNT_NUM && len < (int)sizeof(line); i++)
+    {
+        len += snprintf(line + len, sizeof(line) - len, "%s=%u ", s_counter_names[i], (unsigned)snapshot.counters[i]);
+    }
+    ESP_LOGI(TELEMETRY_TAG, "%s", line);
+
+    for (int h = 0; h < TELEMETRY_HIST_NUM; h++)
+    {
+        len = snprintf(line, sizeof(line), "%-12s", s_hist_names[h]);
+        for (int b = 0; b < TELEMETRY_HIST_BUCKETS && len < (int)sizeof(line); b++)
+        {
+            len += snprintf(line + len, sizeof(line) - len, " %u", (unsigned)snapshot.hist[h][b]);
+        }
+        ESP_LOGI(TELEMETRY_TAG, "%s", line);
+    }
+}
+
+/**
+ * \brief Log a summary periodically, from a task of its own.
+ * \param period_ms Period of the summary, 0 to only collect the data.
+ * \param priority Priority of the summary task, should be low.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t telemetry_start(uint32_t period_ms, uint32_t priority)
+{
+    esp_err_t status = ESP_OK;
+
+    if (period_ms == 0 || s_summary_timer != NULL)
+    {
+        return ESP_OK;
+    }
+
+    if (s_task_handle == NULL &&
+        xTaskCreate(telemetry_task, "Telemetry", TELEMETRY_TASK_STACK_SIZE, NULL, priority, &s_task_handle) != pdPASS)
+    {
+        ESP_LOGE(TELEMETRY_TAG, "Summary task creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    const esp_timer_create_args_t timer_args =
+    {
+        .callback = telemetry_summary_cb,
+        .name = "telemetry",
+    };
+
+    status = esp_timer_create(&timer_args, &s_summary_timer);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TELEMETRY_TAG, "Summary timer creation failed");
+        return status;
+    }
+
+    status = esp_timer_start_periodic(s_summary_timer, (uint64_t)period_ms * 1000);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TELEMETRY_TAG, "Summary timer start failed");
+        return status;
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,114 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Lock-free telemetry of the audio pipeline (counters and histograms)
+ * 
+ * No licence
+ */
+
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+/*** Includes ********************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+/*** Defines *********************************************************************/
+
+/* log tag */
+#define TELEMETRY_TAG               "TELEMETRY"
+
+/* buckets of every histogram */
+#define TELEMETRY_HIST_BUCKETS      (16)
+
+/*** Enumerations ****************************************************************/
+
+typedef enum
+{
+    TELEMETRY_CNT_PACKETS = 0,          /* A2DP packets received */
+    TELEMETRY_CNT_BYTES,                /* PCM bytes received */
+    TELEMETRY_CNT_PACKETS_DROPPED,      /* packets lost because the ring was full */
+    TELEMETRY_CNT_FRAMES_TRIMMED,       /* frames removed to bring the ring back on target */
+    TELEMETRY_CNT_OVERFLOWS,            /* entries in the dropping mode */
+    TELEMETRY_CNT_UNDERFLOWS,           /* entries in the concealing mode */
+    TELEMETRY_CNT_FRAMES_CONCEALED,     /* frames synthesized during underflows */
+    TELEMETRY_CNT_PREFETCH_RESTARTS,    /* underflows too long to be concealed */
+    TELEMETRY_CNT_DEADLINE_MISSES,      /* I2S writes late enough for the DMA to run dry */
+    TELEMETRY_CNT_NUM,
+}
+telemetry_counter_t;
+
+typedef enum
+{
+    TELEMETRY_HIST_FILL_WRITE = 0,      /* ring fill level after a write, in 1/16 of capacity */
+    TELEMETRY_HIST_FILL_READ,           /* ring fill level before a read, in 1/16 of capacity */
+    TELEMETRY_HIST_QUEUE_MS,            /* time a slab spent queued, log2 of ms */
+    TELEMETRY_HIST_UNDERFLOW_MS,        /* duration of an underflow, log2 of ms */
+    TELEMETRY_HIST_OVERFLOW_MS,         /* duration of an overflow, log2 of ms */
+    TELEMETRY_HIST_I2S_WRITE_US,        /* time blocked in the I2S write, log2 of us */
+    TELEMETRY_HIST_NUM,
+}
+telemetry_hist_t;
+
+/*** Structures ******************************************************************/
+
+typedef struct
+{
+    uint32_t counters[TELEMETRY_CNT_NUM];
+    uint32_t hist[TELEMETRY_HIST_NUM][TELEMETRY_HIST_BUCKETS];
+}
+telemetry_snapshot_t;
+
+/*** Extern functions ************************************************************/
+
+/**
+ * \brief Add to a counter. Safe from any task, constant time.
+ * \param counter Counter to increment.
+ * \param n Amount added.
+ */
+void telemetry_count(telemetry_counter_t counter, uint32_t n);
+
+/**
+ * \brief Record a value in a histogram with power of two buckets: bucket 0 holds 0,
+ *        bucket n holds [2^(n-1), 2^n[, the last bucket holds everything above.
+ * \param hist Histogram to update.
+ * \param value Value in the unit of the histogram.
+ */
+void telemetry_record(telemetry_hist_t hist, uint32_t value);
+
+/**
+ * \brief Record a fill level in a histogram with linear buckets.
+ * \param hist Histogram to update.
+ * \param level Current fill level.
+ * \param capacity Fill level of a full buffer.
+ */
+void telemetry_record_fill(telemetry_hist_t hist, size_t level, size_t capacity);
+
+/**
+ * \brief Copy every counter and histogram.
+ * \param snapshot Destination of the copy.
+ */
+void telemetry_snapshot(telemetry_snapshot_t* snapshot);
+
+/**
+ * \brief Clear every counter and histogram.
+ */
+void telemetry_reset(void);
+
+/**
+ * \brief Log a compact summary of the counters and histograms.
+ */
+void telemetry_log_summary(void);
+
+/**
+ * \brief Log a summary periodically, from a task of its own.
+ * \param period_ms Period of the summary, 0 to only collect the data.
+ * \param priority Priority of the summary task, should be low.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t telemetry_start(uint32_t period_ms, uint32_t priority);
+
+#endif /* __TELEMETRY_H__ */
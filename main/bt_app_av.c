@@ -10,9 +10,11 @@
 #include <string.h>
 #include <inttypes.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 
 #include "bt_app_core.h"
 #include "bt_app_av.h"
+#include "log/deferred_log.h"
 #include "esp_bt_main.h"
 #include "esp_bt_device.h"
 #include "esp_gap_bt_api.h"
@@ -36,15 +38,16 @@
 #define APP_RC_CT_TL_RN_PLAYBACK_CHANGE  (3)
 #define APP_RC_CT_TL_RN_PLAY_POS_CHANGE  (4)
 
-/* Application layer causes delay value */
-#define APP_DELAY_VALUE                  50  // 5ms
+/* delay reporting, values in 1/10 ms */
+#define APP_DELAY_REPORT_PERIOD_MS       (1000)
+#define APP_DELAY_REPORT_HYSTERESIS      (100)  // 10ms
 
 /*******************************
  * STATIC FUNCTION DECLARATIONS
  ******************************/
 
-/* allocate new meta buffer */
-static void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param);
+/* copy the metadata text next to the dispatched parameter */
+static void bt_app_copy_meta_buffer(void *p_dest, void *p_src, int len);
 /* handler for new track is loaded */
 static void bt_av_new_track(void);
 /* handler for track status change */
@@ -53,10 +56,10 @@ static void bt_av_playback_changed(void);
 static void bt_av_play_pos_changed(void);
 /* notification event handler */
 static void bt_av_notify_evt_handler(uint8_t event_id, esp_avrc_rn_param_t *event_parameter);
-/* installation for i2s */
-static void bt_i2s_driver_install(void);
-/* uninstallation for i2s */
-static void bt_i2s_driver_uninstall(void);
+/* start the i2s output from the held latency profile, the channel is only created again when its DMA depth changed */
+static void bt_i2s_driver_enable(void);
+/* stop the i2s output and release the latency profile, the channel is kept for the next connection */
+static void bt_i2s_driver_disable(void);
 /* set volume by remote controller */
 static void volume_set_by_controller(uint8_t volume);
 /* a2dp event handler */
@@ -65,6 +68,10 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param);
 static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param);
 /* avrc target event handler */
 static void bt_av_hdl_avrc_tg_evt(uint16_t event, void *p_param);
+/* delay report timer callback */
+static void bt_av_delay_report_timer_cb(void *arg);
+/* delay report handler, reports the measured pipeline delay when it changed noticeably */
+static void bt_av_hdl_delay_report_evt(uint16_t event, void *p_param);
 
 /*******************************
  * STATIC VARIABLE DEFINITIONS
@@ -72,6 +79,8 @@ static void bt_av_hdl_avrc_tg_evt(uint16_t event, void *p_param);
 
 /* count for audio packet */
 static uint32_t s_pkt_cnt = 0;
+/* packet count log site, printed out of the A2DP data callback */
+DEFERRED_LOG_SITE(s_log_pkt_cnt, BT_AV_TAG, ESP_LOG_INFO, 0, "Audio packet count: %" PRIu32);
 
 /* audio stream datapath state */
 static _lock_t s_audio_state_lock;
@@ -86,16 +95,31 @@ static const char *s_a2d_audio_state_str[] = {"Suspended", "Started"};
 /* AVRC target notification capability bit mask */                                             
 static esp_avrc_rn_evt_cap_mask_t s_avrc_peer_rn_cap;
 
+/* delay reporting */
+static esp_timer_handle_t s_delay_report_timer = NULL;
+static uint16_t s_delay_reported = 0;        /* last delay sent to the source, 1/10 ms */
+static bool s_delay_report_supported = false;
+
+/* task notified of volume and audio state changes */
+static TaskHandle_t s_control_task = NULL;
+
 /* Volume */
 static _lock_t s_volume_lock;
 static uint8_t s_volume = 0;                 /* local volume value */
 static bool s_volume_notify;                 /* notify volume change or not */
 
+/* sample rate of the audio stream */
+static _lock_t s_sample_rate_lock;
+static uint32_t s_sample_rate = 44100;
+
 #ifndef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
 i2s_chan_handle_t tx_chan = NULL;
 #else
 dac_continuous_handle_t tx_chan;
 #endif
+/* DMA depth of the channel, 0 while no channel is allocated */
+static uint32_t s_tx_chan_desc_num = 0;
+static uint32_t s_tx_chan_frame_num = 0;
 
 #if CONFIG_EXAMPLE_AVRCP_CT_COVER_ART_ENABLE
 static bool cover_art_connected = false;
@@ -108,12 +132,16 @@ static uint8_t image_handle_old[7];
  * STATIC FUNCTION DEFINITIONS
  *******************************/
 
-static void bt_app_alloc_meta_buffer(esp_avrc_ct_cb_param_t *param)
+static void bt_app_copy_meta_buffer(void *p_dest, void *p_src, int len)
 {
-    esp_avrc_ct_cb_param_t *rc = (esp_avrc_ct_cb_param_t *)(param);
-    uint8_t *attr_text = (uint8_t *) malloc (rc->meta_rsp.attr_length + 1);
+    esp_avrc_ct_cb_param_t *rc = (esp_avrc_ct_cb_param_t *)(p_dest);
+    uint8_t *attr_text = (uint8_t *)p_dest + len;
 
-    memcpy(attr_text, rc->meta_rsp.attr_text, rc->meta_rsp.attr_length);
+    /* the text lives in the message slot, long attributes are truncated */
+    if (rc->meta_rsp.attr_length > BT_APP_MSG_EXTRA_SIZE - 1) {
+        rc->meta_rsp.attr_length = BT_APP_MSG_EXTRA_SIZE - 1;
+    }
+    memcpy(attr_text, ((esp_avrc_ct_cb_param_t *)p_src)->meta_rsp.attr_text, rc->meta_rsp.attr_length);
     attr_text[rc->meta_rsp.attr_length] = 0;
     rc->meta_rsp.attr_text = attr_text;
 }
@@ -196,13 +224,46 @@ static void bt_av_notify_evt_handler(uint8_t event_id, esp_avrc_rn_param_t *even
     }
 }
 
-void bt_i2s_driver_install(void)
+void bt_i2s_driver_enable(void)
 {
+    /* DMA depth and buffer size follow the latency profile of the connection, held until disabled */
+    bt_audio_latency_profile_t profile;
+    const bt_audio_latency_profile_t *latency = &profile;
+    esp_err_t err;
+
+    bt_audio_latency_hold(&profile);
+
+    if (s_tx_chan_desc_num == latency->dma_desc_num && s_tx_chan_frame_num == latency->dma_frame_num) {
+    #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
+        err = dac_continuous_enable(tx_chan);
+    #else
+        err = i2s_channel_enable(tx_chan);
+    #endif
+        /* already enabled by a connecting state not followed by a disconnection */
+        if (err != ESP_ERR_INVALID_STATE) {
+            ESP_ERROR_CHECK(err);
+        }
+        return;
+    }
+
+    /* first connection, or the latency profile changed since the channel was allocated */
+    if (s_tx_chan_desc_num != 0) {
+    #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
+        /* only disabled channels can be deleted */
+        err = dac_continuous_disable(tx_chan);
+        if (err != ESP_ERR_INVALID_STATE) {
+            ESP_ERROR_CHECK(err);
+        }
+        ESP_ERROR_CHECK(dac_continuous_del_channels(tx_chan));
+    #else
+        ESP_ERROR_CHECK(i2s_del_channel(tx_chan));
+    #endif
+    }
 #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
     dac_continuous_config_t cont_cfg = {
         .chan_mask = DAC_CHANNEL_MASK_ALL,
-        .desc_num = 8,
-        .buf_size = 2048,
+        .desc_num = latency->dma_desc_num,
+        .buf_size = latency->dma_frame_num * 2 * sizeof(int16_t),
         .freq_hz = 44100,
         .offset = 127,
         .clk_src = DAC_DIGI_CLK_SRC_DEFAULT,   // Using APLL as clock source to get a wider frequency range
@@ -215,6 +276,8 @@ void bt_i2s_driver_install(void)
 #else
     i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
     chan_cfg.auto_clear = true;
+    chan_cfg.dma_desc_num = latency->dma_desc_num;
+    chan_cfg.dma_frame_num = latency->dma_frame_num;
     i2s_std_config_t std_cfg = {
         .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(44100),
         .slot_cfg = I2S_STD_MSB_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_STEREO),
@@ -236,17 +299,28 @@ void bt_i2s_driver_install(void)
     ESP_ERROR_CHECK(i2s_channel_init_std_mode(tx_chan, &std_cfg));
     ESP_ERROR_CHECK(i2s_channel_enable(tx_chan));
 #endif
+    s_tx_chan_desc_num = latency->dma_desc_num;
+    s_tx_chan_frame_num = latency->dma_frame_num;
 }
 
-void bt_i2s_driver_uninstall(void)
+void bt_i2s_driver_disable(void)
 {
-#ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-    ESP_ERROR_CHECK(dac_continuous_disable(tx_chan));
-    ESP_ERROR_CHECK(dac_continuous_del_channels(tx_chan));
-#else
-    ESP_ERROR_CHECK(i2s_channel_disable(tx_chan));
-    ESP_ERROR_CHECK(i2s_del_channel(tx_chan));
-#endif
+    esp_err_t err = ESP_OK;
+
+    /* the channel stays allocated across connections: a disconnection without a prior connecting
+     * state finds it never created, or already disabled */
+    if (s_tx_chan_desc_num != 0) {
+    #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
+        err = dac_continuous_disable(tx_chan);
+    #else
+        err = i2s_channel_disable(tx_chan);
+    #endif
+    }
+    if (err != ESP_ERR_INVALID_STATE) {
+        ESP_ERROR_CHECK(err);
+    }
+    /* the engine is idle, a latency selected during the connection can take effect */
+    bt_audio_latency_release();
 }
 
 static void volume_set_by_controller(uint8_t volume)
@@ -257,6 +331,10 @@ static void volume_set_by_controller(uint8_t volume)
     _lock_acquire(&s_volume_lock);
     s_volume = volume;
     _lock_release(&s_volume_lock);
+
+    if (s_control_task) {
+        xTaskNotify(s_control_task, BT_APP_NOTIFY_VOLUME, eSetBits);
+    }
 }
 
 void bt_volume_set_by_local_host(uint8_t volume)
@@ -268,6 +346,10 @@ void bt_volume_set_by_local_host(uint8_t volume)
     s_volume = volume;
     _lock_release(&s_volume_lock);
 
+    if (s_control_task) {
+        xTaskNotify(s_control_task, BT_APP_NOTIFY_VOLUME, eSetBits);
+    }
+
     /* send notification response to remote AVRCP controller */
     if (s_volume_notify) {
         esp_avrc_rn_param_t rn_param;
@@ -277,6 +359,32 @@ void bt_volume_set_by_local_host(uint8_t volume)
     }
 }
 
+static void bt_av_delay_report_timer_cb(void *arg)
+{
+    /* measure and report from the application task */
+    if (s_delay_report_supported) {
+        bt_app_work_dispatch_prio(bt_av_hdl_delay_report_evt, 0, NULL, 0, NULL, BT_APP_PRIO_LOW);
+    }
+}
+
+static void bt_av_hdl_delay_report_evt(uint16_t event, void *p_param)
+{
+    uint32_t delay = bt_audio_get_pipeline_delay_us() / 100;
+
+    if (delay > UINT16_MAX) {
+        delay = UINT16_MAX;
+    }
+
+    /* the fill level keeps moving a little, only report noticeable changes */
+    if (s_delay_reported == 0 ||
+        delay >= (uint32_t)s_delay_reported + APP_DELAY_REPORT_HYSTERESIS ||
+        delay + APP_DELAY_REPORT_HYSTERESIS <= s_delay_reported) {
+        ESP_LOGI(BT_AV_TAG, "Pipeline delay: %"PRIu32" * 1/10 ms", delay);
+        esp_a2d_sink_set_delay_value((uint16_t)delay);
+        s_delay_reported = (uint16_t)delay;
+    }
+}
+
 static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
 {
     ESP_LOGD(BT_AV_TAG, "%s event: %d", __func__, event);
@@ -292,13 +400,17 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
             s_a2d_conn_state_str[a2d->conn_stat.state], bda[0], bda[1], bda[2], bda[3], bda[4], bda[5]);
         if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_DISCONNECTED) {
             esp_bt_gap_set_scan_mode(ESP_BT_CONNECTABLE, ESP_BT_GENERAL_DISCOVERABLE);
-            bt_i2s_driver_uninstall();
+            esp_timer_stop(s_delay_report_timer);
+            s_delay_report_supported = false;
+            /* park the I2S task before its output stops */
             bt_i2s_task_shut_down();
+            bt_i2s_driver_disable();
         } else if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTED){
             esp_bt_gap_set_scan_mode(ESP_BT_NON_CONNECTABLE, ESP_BT_NON_DISCOVERABLE);
             bt_i2s_task_start_up();
+            esp_timer_start_periodic(s_delay_report_timer, APP_DELAY_REPORT_PERIOD_MS * 1000);
         } else if (a2d->conn_stat.state == ESP_A2D_CONNECTION_STATE_CONNECTING) {
-            bt_i2s_driver_install();
+            bt_i2s_driver_enable();
         }
         break;
     }
@@ -326,6 +438,10 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
         s_audio_state = new_state;
         _lock_release(&s_audio_state_lock);
 
+        if (s_control_task) {
+            xTaskNotify(s_control_task, BT_APP_NOTIFY_AUDIO_STATE, eSetBits);
+        }
+
         if (ESP_A2D_AUDIO_STATE_STARTED == a2d->audio_stat.state) {
             s_pkt_cnt = 0;
         }
@@ -351,13 +467,16 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
             if (p_mcc->cie.sbc_info.ch_mode & ESP_A2D_SBC_CIE_CH_MODE_MONO) {
                 ch_count = 1;
             }
+            /* the I2S task is parked before its channel is rebuilt or reclocked, the audio
+             * buffered in the old format is dropped with the ring */
+            bool streaming = bt_i2s_task_shut_down();
         #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
             dac_continuous_disable(tx_chan);
             dac_continuous_del_channels(tx_chan);
             dac_continuous_config_t cont_cfg = {
                 .chan_mask = DAC_CHANNEL_MASK_ALL,
-                .desc_num = 8,
-                .buf_size = 2048,
+                .desc_num = s_tx_chan_desc_num,
+                .buf_size = s_tx_chan_frame_num * 2 * sizeof(int16_t),
                 .freq_hz = sample_rate,
                 .offset = 127,
                 .clk_src = DAC_DIGI_CLK_SRC_DEFAULT,   // Using APLL as clock source to get a wider frequency range
@@ -383,7 +502,20 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
                      p_mcc->cie.sbc_info.alloc_mthd,
                      p_mcc->cie.sbc_info.min_bitpool,
                      p_mcc->cie.sbc_info.max_bitpool);
+            bt_i2s_set_pcm_format(sample_rate, ch_count);
+            if (streaming) {
+                bt_i2s_task_start_up();
+            }
             ESP_LOGI(BT_AV_TAG, "Audio player configured, sample rate: %d", sample_rate);
+
+            /* codec filters are retuned by the control task */
+            _lock_acquire(&s_sample_rate_lock);
+            s_sample_rate = sample_rate;
+            _lock_release(&s_sample_rate_lock);
+
+            if (s_control_task) {
+                xTaskNotify(s_control_task, BT_APP_NOTIFY_SAMPLE_RATE, eSetBits);
+            }
         }
         break;
     }
@@ -414,6 +546,7 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
         ESP_LOGI(BT_AV_TAG, "protocol service capabilities configured: 0x%x ", a2d->a2d_psc_cfg_stat.psc_mask);
         if (a2d->a2d_psc_cfg_stat.psc_mask & ESP_A2D_PSC_DELAY_RPT) {
             ESP_LOGI(BT_AV_TAG, "Peer device support delay reporting");
+            s_delay_report_supported = true;
         } else {
             ESP_LOGI(BT_AV_TAG, "Peer device unsupported delay reporting");
         }
@@ -433,8 +566,9 @@ static void bt_av_hdl_a2d_evt(uint16_t event, void *p_param)
     case ESP_A2D_SNK_GET_DELAY_VALUE_EVT: {
         a2d = (esp_a2d_cb_param_t *)(p_param);
         ESP_LOGI(BT_AV_TAG, "Get delay report value: delay_value: %u * 1/10 ms", a2d->a2d_get_delay_value_stat.delay_value);
-        /* Default delay value plus delay caused by application layer */
-        esp_a2d_sink_set_delay_value(a2d->a2d_get_delay_value_stat.delay_value + APP_DELAY_VALUE);
+        /* replace the default delay value by the delay of the audio pipeline */
+        s_delay_reported = 0;
+        bt_av_hdl_delay_report_evt(0, NULL);
         break;
     }
     /* others */
@@ -484,7 +618,6 @@ static void bt_av_hdl_avrc_ct_evt(uint16_t event, void *p_param)
             }
         }
 #endif
-        free(rc->meta_rsp.attr_text);
         break;
     }
     /* when notified, this event comes */
@@ -637,7 +770,8 @@ void bt_app_a2d_cb(esp_a2d_cb_event_t event, esp_a2d_cb_param_t *param)
     case ESP_A2D_SNK_PSC_CFG_EVT:
     case ESP_A2D_SNK_SET_DELAY_VALUE_EVT:
     case ESP_A2D_SNK_GET_DELAY_VALUE_EVT: {
-        bt_app_work_dispatch(bt_av_hdl_a2d_evt, event, param, sizeof(esp_a2d_cb_param_t), NULL);
+        /* few and all about the stream itself, never queued behind AVRC traffic */
+        bt_app_work_dispatch_prio(bt_av_hdl_a2d_evt, event, param, sizeof(esp_a2d_cb_param_t), NULL, BT_APP_PRIO_HIGH);
         break;
     }
     default:
@@ -654,7 +788,7 @@ void bt_app_a2d_data_cb(const uint8_t *data, uint32_t len)
 
     /* log the number every 100 packets */
     if (++s_pkt_cnt % 100 == 0) {
-        ESP_LOGI(BT_AV_TAG, "Audio packet count: %"PRIu32, s_pkt_cnt);
+        deferred_log_push(&s_log_pkt_cnt, s_pkt_cnt, 0);
     }
 }
 
@@ -685,15 +819,22 @@ void bt_app_rc_ct_cb(esp_avrc_ct_cb_event_t event, esp_avrc_ct_cb_param_t *param
 #endif
     switch (event) {
     case ESP_AVRC_CT_METADATA_RSP_EVT:
-        bt_app_alloc_meta_buffer(param);
-        /* fall through */
+        bt_app_work_dispatch_prio(bt_av_hdl_avrc_ct_evt, event, param, sizeof(esp_avrc_ct_cb_param_t),
+                                  bt_app_copy_meta_buffer, BT_APP_PRIO_LOW);
+        break;
+    case ESP_AVRC_CT_CHANGE_NOTIFY_EVT:
+        /* e.g. play position updates, only the latest of each notification matters */
+        bt_app_work_dispatch_coalesced(bt_av_hdl_avrc_ct_evt, event, param->change_ntf.event_id,
+                                       param, sizeof(esp_avrc_ct_cb_param_t), BT_APP_PRIO_LOW);
+        break;
+    case ESP_AVRC_CT_COVER_ART_DATA_EVT:
+        bt_app_work_dispatch_prio(bt_av_hdl_avrc_ct_evt, event, param, sizeof(esp_avrc_ct_cb_param_t), NULL, BT_APP_PRIO_LOW);
+        break;
     case ESP_AVRC_CT_CONNECTION_STATE_EVT:
     case ESP_AVRC_CT_PASSTHROUGH_RSP_EVT:
-    case ESP_AVRC_CT_CHANGE_NOTIFY_EVT:
     case ESP_AVRC_CT_REMOTE_FEATURES_EVT:
     case ESP_AVRC_CT_GET_RN_CAPABILITIES_RSP_EVT:
     case ESP_AVRC_CT_COVER_ART_STATE_EVT:
-    case ESP_AVRC_CT_COVER_ART_DATA_EVT:
     case ESP_AVRC_CT_PROF_STATE_EVT: {
         bt_app_work_dispatch(bt_av_hdl_avrc_ct_evt, event, param, sizeof(esp_avrc_ct_cb_param_t), NULL);
         break;
@@ -707,10 +848,13 @@ void bt_app_rc_ct_cb(esp_avrc_ct_cb_event_t event, esp_avrc_ct_cb_param_t *param
 void bt_app_rc_tg_cb(esp_avrc_tg_cb_event_t event, esp_avrc_tg_cb_param_t *param)
 {
     switch (event) {
+    case ESP_AVRC_TG_SET_ABSOLUTE_VOLUME_CMD_EVT:
+        /* a volume slider sends bursts of commands, only the latest one is applied */
+        bt_app_work_dispatch_coalesced(bt_av_hdl_avrc_tg_evt, event, 0, param, sizeof(esp_avrc_tg_cb_param_t), BT_APP_PRIO_HIGH);
+        break;
     case ESP_AVRC_TG_CONNECTION_STATE_EVT:
     case ESP_AVRC_TG_REMOTE_FEATURES_EVT:
     case ESP_AVRC_TG_PASSTHROUGH_CMD_EVT:
-    case ESP_AVRC_TG_SET_ABSOLUTE_VOLUME_CMD_EVT:
     case ESP_AVRC_TG_REGISTER_NOTIFICATION_EVT:
     case ESP_AVRC_TG_SET_PLAYER_APP_VALUE_EVT:
     case ESP_AVRC_TG_PROF_STATE_EVT:
@@ -729,12 +873,24 @@ void bt_app_av_init(void)
 {
     _lock_init(&s_volume_lock);
     _lock_init(&s_audio_state_lock);
+    _lock_init(&s_sample_rate_lock);
+
+    const esp_timer_create_args_t delay_timer_args = {
+        .callback = bt_av_delay_report_timer_cb,
+        .name = "delay_report",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&delay_timer_args, &s_delay_report_timer));
 
     s_volume = 0;
     s_audio_state = BT_AUDIO_STOPPED;
     s_volume_notify = false;
 }
 
+void bt_app_av_set_control_task(TaskHandle_t task)
+{
+    s_control_task = task;
+}
+
 /**
  * \brief  get volume 
  * 
@@ -761,4 +917,18 @@ bt_audio_state_t bt_app_get_audio_state(void)
     ret = s_audio_state;
     _lock_release(&s_audio_state_lock);
     return ret;
-}
\ No newline at end of file
+}
+
+/**
+ * \brief  get sample rate of the audio stream
+ * 
+ * @return sample rate in Hz, as negotiated by the last stream configuration
+ */
+uint32_t bt_app_get_sample_rate(void)
+{
+    uint32_t rate;
+    _lock_acquire(&s_sample_rate_lock);
+    rate = s_sample_rate;
+    _lock_release(&s_sample_rate_lock);
+    return rate;
+}
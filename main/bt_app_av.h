@@ -13,6 +13,8 @@
 #include <stdbool.h>
 #include "esp_a2dp_api.h"
 #include "esp_avrc_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 
 /*** Defines **********************************************************************/
 
@@ -21,6 +23,11 @@
 #define BT_RC_TG_TAG    "RC_TG"
 #define BT_RC_CT_TAG    "RC_CT"
 
+/* notification bits sent to the control task */
+#define BT_APP_NOTIFY_VOLUME        (1 << 0)    /* volume changed */
+#define BT_APP_NOTIFY_AUDIO_STATE   (1 << 1)    /* audio stream started or stopped */
+#define BT_APP_NOTIFY_SAMPLE_RATE   (1 << 2)    /* audio stream sample rate changed */
+
 /*** Enumerations *****************************************************************/
 
 typedef enum 
@@ -85,6 +92,13 @@ void bt_app_rc_tg_cb(esp_avrc_tg_cb_event_t event, esp_avrc_tg_cb_param_t *param
  */
 void bt_volume_set_by_local_host(uint8_t volume);
 
+/**
+ * @brief  set the task notified of volume and audio state changes
+ *
+ * @param [in] task  task receiving BT_APP_NOTIFY_* bits, NULL to stop notifying
+ */
+void bt_app_av_set_control_task(TaskHandle_t task);
+
 /**
  * \brief  get volume 
  * 
@@ -99,4 +113,11 @@ uint8_t bt_app_get_volume(void);
  */
 bt_audio_state_t bt_app_get_audio_state(void);
 
+/**
+ * \brief  get sample rate of the audio stream
+ * 
+ * @return sample rate in Hz, as negotiated by the last stream configuration
+ */
+uint32_t bt_app_get_sample_rate(void);
+
 #endif /* __BT_APP_AV_H__*/
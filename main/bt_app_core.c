@@ -7,30 +7,205 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdatomic.h>
+#include <inttypes.h>
 #include "freertos/FreeRTOSConfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/queue.h"
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "sys/lock.h"
+#include "esp_a2dp_api.h"
+#include "esp_avrc_api.h"
 #include "bt_app_core.h"
+#include "audio/plc.h"
+#include "audio/telemetry.h"
+#include "log/deferred_log.h"
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+#include "audio/asrc.h"
+#endif
 #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
 #include "driver/dac_continuous.h"
 #else
 #include "driver/i2s_std.h"
 #endif
-#include "freertos/ringbuf.h"
 
+/**
+ * PCM data travels from the A2DP data callback to the I2S task through a lock-free ring of
+ * fixed-size slabs. A slab holds exactly one I2S DMA buffer
+ * (`dma_frame_num * i2s_channel_num * i2s_data_bit_width / 8` bytes), so each I2S write is
+ * one whole slab, never split at the wrap of the ring. The slab size follows the latency
+ * profile of the connection.
+ *
+ * This is not a zero-copy path: the producer copies each packet into the slabs, and
+ * i2s_channel_write copies each slab into the DMA buffers owned by the driver. Compared to a
+ * FreeRTOS ringbuffer, it only removes the spinlock and the split reads from the hot path.
+ */
+#define PCM_SLAB_MAX_SIZE              (BT_AUDIO_CHUNK_FRAMES_MAX * 2 * 2)
+#define PCM_SLAB_NUM                   (32)        /* must be a power of two */
+#define PCM_SLAB_MASK                  (PCM_SLAB_NUM - 1)
+
+#define RINGBUF_HIGHEST_WATER_LEVEL    (PCM_SLAB_NUM * s_pcm_ring.slab_size)
+
+/**
+ * The audio engine (I2S task, its semaphore and the slab storage) is allocated once at boot,
+ * sized for the largest latency profile, and only moves between the idle and streaming states
+ * afterwards: connections never touch the heap.
+ */
+#define BT_I2S_PARK_TIMEOUT_MS         (200)
+#define BT_I2S_PARKED_BIT              (1 << 0)    /* I2S task is in its idle wait */
+
+/* work dispatch: one queue per priority class, parameters are copied into a fixed pool of slots */
+#define BT_APP_QUEUE_LEN_HIGH          (6)
+#define BT_APP_QUEUE_LEN_NORMAL        (8)
+#define BT_APP_QUEUE_LEN_LOW           (10)
+#define BT_APP_QUEUE_LEN_MAX           (BT_APP_QUEUE_LEN_LOW)
+#define BT_APP_TASK_QUEUE_LEN          (BT_APP_QUEUE_LEN_HIGH + BT_APP_QUEUE_LEN_NORMAL + BT_APP_QUEUE_LEN_LOW)
+#define BT_APP_MSG_SLOT_NUM            (BT_APP_TASK_QUEUE_LEN)
+#define BT_APP_COALESCE_NUM            (8)         /* coalescable messages queued at once */
+
+/* task layout: Bluetooth and event dispatch on one core, PCM transfer and DSP on the other */
+#ifdef CONFIG_FREERTOS_UNICORE
+#define BT_APP_TASK_CORE               (0)
+#define BT_I2S_TASK_CORE               (0)
+#else
+#define BT_APP_TASK_CORE               (CONFIG_EXAMPLE_BT_APP_TASK_CORE)
+#define BT_I2S_TASK_CORE               (CONFIG_EXAMPLE_I2S_TASK_CORE)
+#endif
+#define BT_APP_TASK_PRIORITY           (CONFIG_EXAMPLE_BT_APP_TASK_PRIORITY)
+#define BT_APP_TASK_STACK_SIZE         (CONFIG_EXAMPLE_BT_APP_TASK_STACK_SIZE)
+#define BT_I2S_TASK_PRIORITY           (CONFIG_EXAMPLE_I2S_TASK_PRIORITY)
+#define BT_I2S_TASK_STACK_SIZE         (CONFIG_EXAMPLE_I2S_TASK_STACK_SIZE)
+
+/**
+ * The prefetch water level follows the measured packet arrival jitter: it is the decaying
+ * peak of packet lateness plus a safety margin, kept between the floor and the ceiling of
+ * the latency profile. Above twice the target, packets are trimmed until the fill level is
+ * back on target.
+ */
+#define JB_MARGIN_MS                   (10)        /* added on top of the lateness peak */
+#define JB_PEAK_DECAY_SHIFT            (10)        /* peak decays by 1/1024 per packet */
+#define JB_BASELINE_LEAK_US            (2)         /* per packet, absorbs clock drift */
+#define JB_RESYNC_GAP_US               (500 * 1000)
+
+#define PCM_DEFAULT_BYTE_RATE          (44100 * 2 * 2)
+#define PCM_REFERENCE_RATE             (44100)     /* turns latencies into frame counts */
+#define PCM_DEFAULT_CHANNELS           (2)
+
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+#define PCM_OUT_EXTRA_SAMPLES          (ASRC_MAX_EXTRA_FRAMES * ASRC_MAX_CHANNELS)
+#else
+#define PCM_OUT_EXTRA_SAMPLES          (0)
+#endif
+
+/* overflow: frames dropped at most per packet, each splice being crossfaded */
+#define PCM_TRIM_MAX_FRAMES            (16)
+#define PCM_TRIM_XFADE_FRAMES          (32)
 
-#define RINGBUF_HIGHEST_WATER_LEVEL    (32 * 1024)
-#define RINGBUF_PREFETCH_WATER_LEVEL   (20 * 1024)
+/**
+ * concealment: resume once the ring is back at the jitter buffer target, the same level a prefetch
+ * waits for, so that a marginal link does not flap between concealed and real audio; never on fewer
+ * slabs than PLC_RESUME_MIN_SLABS. Give up and prefetch after PLC_MAX_MS.
+ */
+#define PLC_RESUME_MIN_SLABS           (2)
+#define PLC_MAX_MS                     (200)
 
+/**
+ * Each transition belongs to one side and goes through ringbuffer_mode_change(), a compare and
+ * swap: the producer moves between processing and dropping and ends a prefetch, the I2S task
+ * enters and leaves concealment. The I2S task sleeps on its semaphore while prefetching, so
+ * every transition out of prefetching gives it.
+ */
 enum {
     RINGBUFFER_MODE_PROCESSING,    /* ringbuffer is buffering incoming audio data, I2S is working */
     RINGBUFFER_MODE_PREFETCHING,   /* ringbuffer is buffering incoming audio data, I2S is waiting */
-    RINGBUFFER_MODE_DROPPING       /* ringbuffer is not buffering (dropping) incoming audio data, I2S is working */
+    RINGBUFFER_MODE_DROPPING,      /* ringbuffer is trimming incoming audio data back to its target, I2S is working */
+    RINGBUFFER_MODE_CONCEALING     /* ringbuffer underflowed, I2S is playing synthesized audio until data is back */
 };
 
+/* single-producer / single-consumer ring of PCM slabs */
+typedef struct {
+    uint8_t *slabs;               /* PCM_SLAB_NUM slabs of slab_size bytes, static storage */
+    size_t slab_size;             /* bytes per slab, one I2S write */
+    size_t fill;                  /* bytes already written in the slab at head, producer only */
+    atomic_uint_fast32_t written; /* count of bytes written, modulo 2^32, published by the producer */
+    atomic_uint_fast32_t head;    /* count of published slabs, written by the producer only */
+    atomic_uint_fast32_t tail;    /* count of consumed slabs, written by the consumer only */
+    atomic_bool consumer_waiting; /* consumer is blocked waiting for a slab */
+    uint32_t stamp_us[PCM_SLAB_NUM]; /* time each slab was published, for the queue time */
+} pcm_slab_ring_t;
+
+/* every parameter dispatched to the application task */
+typedef union {
+    esp_a2d_cb_param_t a2d;
+    esp_avrc_ct_cb_param_t avrc_ct;
+    esp_avrc_tg_cb_param_t avrc_tg;
+} bt_app_msg_param_t;
+
+/* work queue of a priority class */
+typedef struct {
+    QueueHandle_t queue;
+    StaticQueue_t queue_buffer;
+    uint8_t storage[BT_APP_QUEUE_LEN_MAX * sizeof(bt_app_msg_t)];
+    atomic_uint_fast32_t dispatched;
+    atomic_uint_fast32_t dropped;
+    atomic_uint_fast32_t coalesced;
+    atomic_uint_fast32_t max_depth;
+} bt_app_work_queue_t;
+
+/* queued message whose parameter may still be replaced by a newer event of the same kind */
+typedef struct {
+    bt_app_cb_t cb;
+    uint16_t event;
+    uint32_t key;
+    void *slot;                   /* NULL when the entry is free */
+} bt_app_coalesce_entry_t;
+
+/* storage of a dispatched parameter and of the data it references */
+typedef struct {
+    bt_app_msg_param_t param;
+    uint8_t extra[BT_APP_MSG_EXTRA_SIZE];
+} bt_app_msg_slot_t;
+
+/* adaptive jitter buffer state, owned by the producer */
+typedef struct {
+    uint32_t byte_rate;           /* PCM bytes per second of the current stream */
+    bool synced;                  /* reference arrival time is valid */
+    int64_t ref_arrival_us;       /* arrival time of the reference packet */
+    int64_t last_arrival_us;      /* arrival time of the previous packet */
+    uint64_t media_bytes;         /* PCM bytes received since the reference packet */
+    int64_t baseline_us;          /* lowest relative delay seen, slowly leaking upwards */
+    int64_t peak_us;              /* decaying peak of packet lateness */
+    size_t target_bytes;          /* current prefetch water level */
+} jitter_buffer_t;
+
+/* log sites of the audio data path, printed later by the deferred log task */
+DEFERRED_LOG_SITE(s_log_underflow, BT_APP_CORE_TAG, ESP_LOG_INFO, 500,
+                  "ringbuffer underflowed! mode changed: RINGBUFFER_MODE_CONCEALING");
+DEFERRED_LOG_SITE(s_log_refilled, BT_APP_CORE_TAG, ESP_LOG_INFO, 500,
+                  "ringbuffer refilled after %" PRIu32 " ms! mode changed: RINGBUFFER_MODE_PROCESSING");
+DEFERRED_LOG_SITE(s_log_still_empty, BT_APP_CORE_TAG, ESP_LOG_INFO, 500,
+                  "ringbuffer still empty! mode changed: RINGBUFFER_MODE_PREFETCHING");
+DEFERRED_LOG_SITE(s_log_decreased, BT_APP_CORE_TAG, ESP_LOG_INFO, 500,
+                  "ringbuffer data decreased! mode changed: RINGBUFFER_MODE_PROCESSING");
+DEFERRED_LOG_SITE(s_log_packet_dropped, BT_APP_CORE_TAG, ESP_LOG_WARN, 1000,
+                  "ringbuffer is full, drop this packet!");
+DEFERRED_LOG_SITE(s_log_overflowed, BT_APP_CORE_TAG, ESP_LOG_WARN, 500,
+                  "ringbuffer overflowed, ready to decrease data! mode changed: RINGBUFFER_MODE_DROPPING");
+DEFERRED_LOG_SITE(s_log_increased, BT_APP_CORE_TAG, ESP_LOG_INFO, 500,
+                  "ringbuffer data increased (target %" PRIu32 " bytes)! mode changed: RINGBUFFER_MODE_PROCESSING");
+DEFERRED_LOG_SITE(s_log_give_failed, BT_APP_CORE_TAG, ESP_LOG_ERROR, 1000,
+                  "semphore give failed");
+DEFERRED_LOG_SITE(s_log_dispatch_dropped, BT_APP_CORE_TAG, ESP_LOG_ERROR, 1000,
+                  "work queue %" PRIu32 " full, event 0x%" PRIx32 " dropped");
+DEFERRED_LOG_SITE(s_log_no_slot, BT_APP_CORE_TAG, ESP_LOG_ERROR, 1000,
+                  "no free message slot, event 0x%" PRIx32 " dropped");
+DEFERRED_LOG_SITE(s_log_deadline_miss, BT_APP_CORE_TAG, ESP_LOG_WARN, 1000,
+                  "I2S write %" PRIu32 " us late, DMA ran dry");
+
 /*******************************
  * STATIC FUNCTION DECLARATIONS
  ******************************/
@@ -40,20 +215,95 @@ static void bt_app_task_handler(void *arg);
 /* handler for I2S task */
 static void bt_i2s_task_handler(void *arg);
 /* message sender */
-static bool bt_app_send_msg(bt_app_msg_t *msg);
+static bool bt_app_send_msg(bt_app_msg_t *msg, bt_app_prio_t prio);
+/* queue a message, with its parameter copied into a slot; key is NULL for non-coalescable work */
+static bool bt_app_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len,
+                            bt_app_copy_cb_t p_copy_cback, bt_app_prio_t prio, const uint32_t *key);
+/* forget a coalescable message once it is out of its queue */
+static void bt_app_coalesce_release(void *slot);
 /* handle dispatched messages */
 static void bt_app_work_dispatched(bt_app_msg_t *msg);
+/* number of bytes buffered in the PCM ring */
+static size_t pcm_ring_filled_bytes(void);
+/* copy data into the PCM ring, publishing every completed slab */
+static size_t pcm_ring_write(const uint8_t *data, size_t size);
+/* get the oldest published slab, NULL if none */
+static uint8_t *pcm_ring_peek(void);
+/* give the oldest published slab back to the producer */
+static void pcm_ring_release(void);
+/* number of slabs ready for the consumer */
+static uint32_t pcm_ring_published_slabs(void);
+/* time the oldest published slab has spent in the ring */
+static uint32_t pcm_ring_peek_age_ms(void);
+/* append a packet, removing drop_frames frames from its middle with a crossfade */
+static size_t pcm_ring_write_trimmed(const uint8_t *data, size_t size, size_t drop_frames);
+/* convert a duration into a PCM byte count aligned on slabs */
+static size_t jitter_buffer_ms_to_bytes(uint32_t ms);
+/* make the requested latency profile current, called with s_latency_lock held and the profile released */
+static void bt_audio_latency_apply(void);
+/* allocate the audio engine once, it stays idle until a stream starts */
+static void bt_i2s_engine_init(void);
+/* check that an I2S write comes before the DMA queue runs dry, call right before each write */
+static void bt_i2s_deadline_check(void);
+/* wait for a slab before concealing: half of the DMA queue, at least one tick */
+static TickType_t bt_i2s_slab_wait_ticks(void);
+/* move the ringbuffer mode, false if the other side changed it first */
+static bool ringbuffer_mode_change(uint32_t from, uint32_t to);
+/* restart the jitter estimation from the default target */
+static void jitter_buffer_reset(void);
+/* account for a packet arrival and update the prefetch target */
+static void jitter_buffer_update(size_t size);
 
 /*******************************
  * STATIC VARIABLE DEFINITIONS
  ******************************/
 
-static QueueHandle_t s_bt_app_task_queue = NULL;  /* handle of work queue */
+static bt_app_work_queue_t s_bt_app_work_queues[BT_APP_PRIO_NUM];  /* work queues, by priority */
+static const uint32_t s_bt_app_work_queue_len[BT_APP_PRIO_NUM] = {
+    [BT_APP_PRIO_HIGH] = BT_APP_QUEUE_LEN_HIGH,
+    [BT_APP_PRIO_NORMAL] = BT_APP_QUEUE_LEN_NORMAL,
+    [BT_APP_PRIO_LOW] = BT_APP_QUEUE_LEN_LOW,
+};
+static SemaphoreHandle_t s_bt_app_work_pending = NULL;  /* messages waiting in any work queue */
+static bt_app_coalesce_entry_t s_bt_app_coalesce[BT_APP_COALESCE_NUM];
+static portMUX_TYPE s_bt_app_coalesce_lock = portMUX_INITIALIZER_UNLOCKED;
+static StaticSemaphore_t s_bt_app_work_pending_buffer;
+static QueueHandle_t s_bt_app_free_slots = NULL;  /* slots available to the dispatcher */
+static StaticQueue_t s_bt_app_free_slots_buffer;
+static uint8_t s_bt_app_free_slots_storage[BT_APP_MSG_SLOT_NUM * sizeof(bt_app_msg_slot_t *)];
+static bt_app_msg_slot_t s_bt_app_msg_slots[BT_APP_MSG_SLOT_NUM];
 static TaskHandle_t s_bt_app_task_handle = NULL;  /* handle of application task  */
 static TaskHandle_t s_bt_i2s_task_handle = NULL;  /* handle of I2S task */
-static RingbufHandle_t s_ringbuf_i2s = NULL;     /* handle of ringbuffer for I2S */
+static StaticTask_t s_bt_i2s_task_buffer;         /* I2S task control block */
+static StackType_t s_bt_i2s_task_stack[BT_I2S_TASK_STACK_SIZE];
+static uint8_t s_pcm_slab_storage[PCM_SLAB_NUM * PCM_SLAB_MAX_SIZE];  /* internal RAM, copied into the DMA buffers by the I2S driver */
+static pcm_slab_ring_t s_pcm_ring = {             /* PCM ring between A2DP and I2S */
+    .slabs = s_pcm_slab_storage,
+};
+static atomic_bool s_streaming;                   /* a stream is running, the ring is in use */
+static EventGroupHandle_t s_i2s_state = NULL;    /* BT_I2S_PARKED_BIT, set by the I2S task */
+static StaticEventGroup_t s_i2s_state_buffer;
+static atomic_bool s_producer_busy;               /* data callback is writing into the ring */
+static int64_t s_i2s_last_write_us = 0;           /* start of the previous I2S write, 0 after a pause */
+static jitter_buffer_t s_jitter_buf = {
+    .byte_rate = PCM_DEFAULT_BYTE_RATE,
+};
+static uint8_t s_pcm_channels = PCM_DEFAULT_CHANNELS;
+static int64_t s_overflow_start_us = 0;           /* entry in the dropping mode, producer only */
+static plc_t s_plc;                               /* concealment of underflows, owned by the I2S task */
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+static asrc_t s_asrc;                             /* drift compensation, owned by the I2S task */
+#endif
+static int16_t s_pcm_out[PCM_SLAB_MAX_SIZE / sizeof(int16_t) + PCM_OUT_EXTRA_SAMPLES];
+static bt_audio_latency_profile_t s_latency;      /* profile of the current connection */
+static int32_t s_fill_avg_q4 = 0;                 /* Q4 low-pass filtered fill level on read */
+static uint32_t s_output_delay_frames = 0;        /* delay downstream of I2S (codec filters) */
+static uint32_t s_latency_requested_ms = CONFIG_EXAMPLE_A2DP_SINK_LATENCY_MS;
+static _lock_t s_latency_lock;                    /* s_latency, s_latency_requested_ms and s_latency_held */
+static bool s_latency_held = false;               /* the I2S channel is built from s_latency */
 static SemaphoreHandle_t s_i2s_write_semaphore = NULL;
-static uint16_t ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
+static StaticSemaphore_t s_i2s_write_semaphore_buffer;
+static atomic_uint_fast32_t ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
 
 /*********************************
  * EXTERNAL FUNCTION DECLARATIONS
@@ -68,20 +318,96 @@ extern dac_continuous_handle_t tx_chan;
  * STATIC FUNCTION DEFINITIONS
  ******************************/
 
-static bool bt_app_send_msg(bt_app_msg_t *msg)
+static bool bt_app_send_msg(bt_app_msg_t *msg, bt_app_prio_t prio)
 {
-    if (msg == NULL) {
+    bt_app_work_queue_t *wq = &s_bt_app_work_queues[prio];
+    uint32_t depth;
+
+    if (msg == NULL || wq->queue == NULL) {
         return false;
     }
 
-    /* send the message to work queue */
-    if (xQueueSend(s_bt_app_task_queue, msg, 10 / portTICK_PERIOD_MS) != pdTRUE) {
-        ESP_LOGE(BT_APP_CORE_TAG, "%s xQueue send failed", __func__);
+    /* send the message to the work queue of its class, never blocking the Bluetooth stack */
+    if (xQueueSend(wq->queue, msg, 0) != pdTRUE) {
+        deferred_log_push(&s_log_dispatch_dropped, prio, msg->event);
         return false;
     }
+    atomic_fetch_add_explicit(&wq->dispatched, 1, memory_order_relaxed);
+    depth = uxQueueMessagesWaiting(wq->queue);
+    if (depth > atomic_load_explicit(&wq->max_depth, memory_order_relaxed)) {
+        atomic_store_explicit(&wq->max_depth, depth, memory_order_relaxed);
+    }
+    xSemaphoreGive(s_bt_app_work_pending);
     return true;
 }
 
+static void bt_app_coalesce_release(void *slot)
+{
+    taskENTER_CRITICAL(&s_bt_app_coalesce_lock);
+    for (int i = 0; i < BT_APP_COALESCE_NUM; i++) {
+        if (s_bt_app_coalesce[i].slot == slot) {
+            s_bt_app_coalesce[i].slot = NULL;
+        }
+    }
+    taskEXIT_CRITICAL(&s_bt_app_coalesce_lock);
+}
+
+static bool bt_app_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len,
+                            bt_app_copy_cb_t p_copy_cback, bt_app_prio_t prio, const uint32_t *key)
+{
+    bt_app_msg_t msg;
+    bt_app_msg_slot_t *slot = NULL;
+
+    memset(&msg, 0, sizeof(bt_app_msg_t));
+    msg.sig = BT_APP_SIG_WORK_DISPATCH;
+    msg.event = event;
+    msg.cb = p_cback;
+
+    if (param_len == 0) {
+        if (bt_app_send_msg(&msg, prio)) {
+            return true;
+        }
+    } else if (p_params && param_len > 0 && (size_t)param_len <= sizeof(bt_app_msg_param_t)) {
+        if (xQueueReceive(s_bt_app_free_slots, &slot, 0) != pdTRUE) {
+            deferred_log_push(&s_log_no_slot, event, 0);
+            atomic_fetch_add_explicit(&s_bt_app_work_queues[prio].dropped, 1, memory_order_relaxed);
+            return false;
+        }
+        msg.param = slot;
+        memcpy(msg.param, p_params, param_len);
+        /* check if caller has provided a copy callback to do the deep copy */
+        if (p_copy_cback) {
+            p_copy_cback(msg.param, p_params, param_len);
+        }
+        /* registered before it is queued, so that the task always finds it to release it */
+        if (key) {
+            taskENTER_CRITICAL(&s_bt_app_coalesce_lock);
+            for (int i = 0; i < BT_APP_COALESCE_NUM; i++) {
+                if (s_bt_app_coalesce[i].slot == NULL) {
+                    s_bt_app_coalesce[i].cb = p_cback;
+                    s_bt_app_coalesce[i].event = event;
+                    s_bt_app_coalesce[i].key = *key;
+                    s_bt_app_coalesce[i].slot = slot;
+                    break;
+                }
+            }
+            taskEXIT_CRITICAL(&s_bt_app_coalesce_lock);
+        }
+        if (bt_app_send_msg(&msg, prio)) {
+            return true;
+        }
+        if (key) {
+            bt_app_coalesce_release(slot);
+        }
+        xQueueSend(s_bt_app_free_slots, &slot, 0);
+    } else {
+        return false;
+    }
+
+    atomic_fetch_add_explicit(&s_bt_app_work_queues[prio].dropped, 1, memory_order_relaxed);
+    return false;
+}
+
 static void bt_app_work_dispatched(bt_app_msg_t *msg)
 {
     if (msg->cb) {
@@ -94,9 +420,19 @@ static void bt_app_task_handler(void *arg)
     bt_app_msg_t msg;
 
     for (;;) {
-        /* receive message from work queue and handle it */
-        if (pdTRUE == xQueueReceive(s_bt_app_task_queue, &msg, (TickType_t)portMAX_DELAY)) {
-            ESP_LOGD(BT_APP_CORE_TAG, "%s, signal: 0x%x, event: 0x%x", __func__, msg.sig, msg.event);
+        /* wait for any message, then take the one of the highest class pending */
+        if (pdTRUE != xSemaphoreTake(s_bt_app_work_pending, (TickType_t)portMAX_DELAY)) {
+            continue;
+        }
+        for (int prio = 0; prio < BT_APP_PRIO_NUM; prio++) {
+            if (pdTRUE != xQueueReceive(s_bt_app_work_queues[prio].queue, &msg, 0)) {
+                continue;
+            }
+            ESP_LOGD(BT_APP_CORE_TAG, "%s, signal: 0x%x, event: 0x%x, priority: %d", __func__, msg.sig, msg.event, prio);
+            /* from now on, newer events of the same kind are queued instead of merged */
+            if (msg.param) {
+                bt_app_coalesce_release(msg.param);
+            }
 
             switch (msg.sig) {
             case BT_APP_SIG_WORK_DISPATCH:
@@ -108,82 +444,473 @@ static void bt_app_task_handler(void *arg)
             } /* switch (msg.sig) */
 
             if (msg.param) {
-                free(msg.param);
+                bt_app_msg_slot_t *slot = (bt_app_msg_slot_t *)msg.param;
+                xQueueSend(s_bt_app_free_slots, &slot, 0);
             }
+            /* one message per wake-up, a higher class may have been filled meanwhile */
+            break;
         }
     }
 }
 
+static size_t pcm_ring_filled_bytes(void)
+{
+    /* from the byte counts, fill is private to the producer and may change meanwhile */
+    uint32_t written = atomic_load_explicit(&s_pcm_ring.written, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&s_pcm_ring.tail, memory_order_acquire);
+
+    return (size_t)(written - tail * (uint32_t)s_pcm_ring.slab_size);
+}
+
+static size_t pcm_ring_write(const uint8_t *data, size_t size)
+{
+    uint32_t head = atomic_load_explicit(&s_pcm_ring.head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&s_pcm_ring.tail, memory_order_acquire);
+    size_t free_bytes = (size_t)(PCM_SLAB_NUM - (head - tail)) * s_pcm_ring.slab_size - s_pcm_ring.fill;
+    size_t written = 0;
+    bool published = false;
+
+    /* a packet is buffered entirely or not at all */
+    if (size > free_bytes) {
+        return 0;
+    }
+
+    while (written < size) {
+        uint8_t *slab = s_pcm_ring.slabs + (head & PCM_SLAB_MASK) * s_pcm_ring.slab_size;
+        size_t chunk = s_pcm_ring.slab_size - s_pcm_ring.fill;
+        if (chunk > size - written) {
+            chunk = size - written;
+        }
+        memcpy(slab + s_pcm_ring.fill, data + written, chunk);
+        s_pcm_ring.fill += chunk;
+        written += chunk;
+        atomic_fetch_add_explicit(&s_pcm_ring.written, chunk, memory_order_release);
+
+        if (s_pcm_ring.fill == s_pcm_ring.slab_size) {
+            /* slab completed, make it visible to the consumer */
+            s_pcm_ring.fill = 0;
+            s_pcm_ring.stamp_us[head & PCM_SLAB_MASK] = (uint32_t)esp_timer_get_time();
+            atomic_store_explicit(&s_pcm_ring.head, ++head, memory_order_release);
+            published = true;
+        }
+    }
+
+    /* only wake up the I2S task when it is actually waiting for data */
+    if (published && atomic_exchange(&s_pcm_ring.consumer_waiting, false)) {
+        xTaskNotifyGive(s_bt_i2s_task_handle);
+    }
+
+    return written;
+}
+
+static uint8_t *pcm_ring_peek(void)
+{
+    uint32_t tail = atomic_load_explicit(&s_pcm_ring.tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&s_pcm_ring.head, memory_order_acquire);
+
+    if (head == tail) {
+        return NULL;
+    }
+    return s_pcm_ring.slabs + (tail & PCM_SLAB_MASK) * s_pcm_ring.slab_size;
+}
+
+static void pcm_ring_release(void)
+{
+    uint32_t tail = atomic_load_explicit(&s_pcm_ring.tail, memory_order_relaxed);
+
+    atomic_store_explicit(&s_pcm_ring.tail, tail + 1, memory_order_release);
+}
+
+static uint32_t pcm_ring_peek_age_ms(void)
+{
+    uint32_t tail = atomic_load_explicit(&s_pcm_ring.tail, memory_order_relaxed);
+
+    return ((uint32_t)esp_timer_get_time() - s_pcm_ring.stamp_us[tail & PCM_SLAB_MASK]) / 1000;
+}
+
+static uint32_t pcm_ring_published_slabs(void)
+{
+    return atomic_load_explicit(&s_pcm_ring.head, memory_order_acquire) -
+           atomic_load_explicit(&s_pcm_ring.tail, memory_order_relaxed);
+}
+
+static size_t pcm_ring_write_trimmed(const uint8_t *data, size_t size, size_t drop_frames)
+{
+    size_t frame_bytes = s_pcm_channels * sizeof(int16_t);
+    size_t frames = size / frame_bytes;
+    size_t split = 0;
+    size_t tail_offset = 0;
+    int16_t xfade[PCM_TRIM_XFADE_FRAMES * 2];
+    const int16_t *a = NULL;
+    const int16_t *b = NULL;
+
+    if (drop_frames == 0 || frames < drop_frames + PCM_TRIM_XFADE_FRAMES) {
+        return pcm_ring_write(data, size);
+    }
+    if (pcm_ring_filled_bytes() + size - drop_frames * frame_bytes > RINGBUF_HIGHEST_WATER_LEVEL) {
+        return 0;
+    }
+
+    /*
+     * splice in the middle of the packet: the frames right before the removed span are faded
+     * out while the frames right after it are faded in
+     */
+    split = (frames - drop_frames - PCM_TRIM_XFADE_FRAMES) / 2;
+    a = (const int16_t *)(data + split * frame_bytes);
+    b = (const int16_t *)(data + (split + drop_frames) * frame_bytes);
+    for (size_t i = 0; i < PCM_TRIM_XFADE_FRAMES * s_pcm_channels; i++) {
+        int32_t gain = (int32_t)((i / s_pcm_channels + 1) * 32768 / (PCM_TRIM_XFADE_FRAMES + 1));
+        xfade[i] = (int16_t)((a[i] * (32768 - gain) + b[i] * gain) >> 15);
+    }
+    tail_offset = (split + drop_frames + PCM_TRIM_XFADE_FRAMES) * frame_bytes;
+
+    pcm_ring_write(data, split * frame_bytes);
+    pcm_ring_write((const uint8_t *)xfade, PCM_TRIM_XFADE_FRAMES * frame_bytes);
+    pcm_ring_write(data + tail_offset, size - tail_offset);
+
+    telemetry_count(TELEMETRY_CNT_FRAMES_TRIMMED, drop_frames);
+    return size - drop_frames * frame_bytes;
+}
+
+static void bt_audio_latency_apply(void)
+{
+    bt_audio_latency_profile_from_ms(s_latency_requested_ms, &s_latency);
+    s_pcm_ring.slab_size = s_latency.chunk_frames * 2 * sizeof(int16_t);
+    ESP_LOGI(BT_APP_CORE_TAG, "latency profile %"PRIu32" ms: dma %"PRIu32"x%"PRIu32" frames, jitter buffer %"PRIu32" [%"PRIu32"-%"PRIu32"] ms",
+             s_latency.latency_ms, s_latency.dma_desc_num, s_latency.dma_frame_num,
+             s_latency.jb_default_ms, s_latency.jb_min_ms, s_latency.jb_max_ms);
+}
+
+static size_t jitter_buffer_ms_to_bytes(uint32_t ms)
+{
+    size_t bytes = (size_t)((uint64_t)s_jitter_buf.byte_rate * ms / 1000);
+
+    /* whole slabs only, the consumer never sees a partially filled slab */
+    bytes = (bytes + s_pcm_ring.slab_size - 1) / s_pcm_ring.slab_size * s_pcm_ring.slab_size;
+    if (bytes > RINGBUF_HIGHEST_WATER_LEVEL) {
+        bytes = RINGBUF_HIGHEST_WATER_LEVEL;
+    }
+    return bytes;
+}
+
+static void jitter_buffer_reset(void)
+{
+    s_jitter_buf.synced = false;
+    s_jitter_buf.peak_us = 0;
+    s_jitter_buf.target_bytes = jitter_buffer_ms_to_bytes(s_latency.jb_default_ms);
+}
+
+static void jitter_buffer_update(size_t size)
+{
+    int64_t now = esp_timer_get_time();
+    int64_t media_us;
+    int64_t delay_us;
+    int64_t lateness_us;
+    uint32_t target_ms;
+
+    /* (re)start the reference after a stream start or a long silence from the source */
+    if (!s_jitter_buf.synced || now - s_jitter_buf.last_arrival_us > JB_RESYNC_GAP_US) {
+        s_jitter_buf.synced = true;
+        s_jitter_buf.ref_arrival_us = now;
+        s_jitter_buf.last_arrival_us = now;
+        s_jitter_buf.media_bytes = size;
+        s_jitter_buf.baseline_us = 0;
+        return;
+    }
+    s_jitter_buf.last_arrival_us = now;
+
+    /* relative delay: how much later than its media time this packet arrived */
+    media_us = (int64_t)(s_jitter_buf.media_bytes * 1000000 / s_jitter_buf.byte_rate);
+    delay_us = (now - s_jitter_buf.ref_arrival_us) - media_us;
+    s_jitter_buf.media_bytes += size;
+
+    if (delay_us < s_jitter_buf.baseline_us) {
+        s_jitter_buf.baseline_us = delay_us;
+    } else {
+        s_jitter_buf.baseline_us += JB_BASELINE_LEAK_US;
+    }
+    lateness_us = delay_us - s_jitter_buf.baseline_us;
+
+    s_jitter_buf.peak_us -= s_jitter_buf.peak_us >> JB_PEAK_DECAY_SHIFT;
+    if (lateness_us > s_jitter_buf.peak_us) {
+        s_jitter_buf.peak_us = lateness_us;
+    }
+
+    target_ms = (uint32_t)(s_jitter_buf.peak_us / 1000) + JB_MARGIN_MS;
+    if (target_ms < s_latency.jb_min_ms) {
+        target_ms = s_latency.jb_min_ms;
+    } else if (target_ms > s_latency.jb_max_ms) {
+        target_ms = s_latency.jb_max_ms;
+    }
+    s_jitter_buf.target_bytes = jitter_buffer_ms_to_bytes(target_ms);
+}
+
 static void bt_i2s_task_handler(void *arg)
 {
     uint8_t *data = NULL;
-    size_t item_size = 0;
-    /**
-     * The total length of DMA buffer of I2S is:
-     * `dma_frame_num * dma_desc_num * i2s_channel_num * i2s_data_bit_width / 8`.
-     * Transmit `dma_frame_num * dma_desc_num` bytes to DMA is trade-off.
-     */
-    const size_t item_size_upto = 240 * 6;
     size_t bytes_written = 0;
+    size_t out_size = 0;
+    size_t frame_bytes = 0;
+    size_t item_size = 0;
+    size_t resume_bytes = 0;
+    int64_t write_start_us = 0;
+    TimeOut_t wait_timeout;
+    TickType_t wait_ticks = 0;
+    TickType_t slab_wait_ticks = 0;
+    uint32_t mode;
 
     for (;;) {
         if (pdTRUE == xSemaphoreTake(s_i2s_write_semaphore, portMAX_DELAY)) {
+            xEventGroupClearBits(s_i2s_state, BT_I2S_PARKED_BIT);
+            /* drop a wake-up left over from the previous stream */
+            ulTaskNotifyTake(pdTRUE, 0);
+            /* the DMA was expected to run dry while prefetching */
+            s_i2s_last_write_us = 0;
+            /* the profile and the format only change while this task is parked */
+            slab_wait_ticks = bt_i2s_slab_wait_ticks();
             for (;;) {
-                item_size = 0;
-                /* receive data from ringbuffer and write it to I2S DMA transmit buffer */
-                data = (uint8_t *)xRingbufferReceiveUpTo(s_ringbuf_i2s, &item_size, (TickType_t)pdMS_TO_TICKS(20), item_size_upto);
-                if (item_size == 0) {
-                    ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer underflowed! mode changed: RINGBUFFER_MODE_PREFETCHING");
-                    ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
+                /* back to idle, the ring may be reset as soon as this task is parked */
+                if (!atomic_load(&s_streaming)) {
                     break;
                 }
+                frame_bytes = s_pcm_channels * sizeof(int16_t);
 
+                if (atomic_load(&ringbuffer_mode) == RINGBUFFER_MODE_CONCEALING) {
+                    /* resume once the ring is refilled to its target, the concealment is crossfaded out */
+                    resume_bytes = s_jitter_buf.target_bytes;
+                    if (resume_bytes < PLC_RESUME_MIN_SLABS * s_pcm_ring.slab_size) {
+                        resume_bytes = PLC_RESUME_MIN_SLABS * s_pcm_ring.slab_size;
+                    }
+                    if ((size_t)pcm_ring_published_slabs() * s_pcm_ring.slab_size >= resume_bytes) {
+                        telemetry_record(TELEMETRY_HIST_UNDERFLOW_MS,
+                                         (uint32_t)((uint64_t)s_plc.concealed_frames * frame_bytes * 1000 / s_jitter_buf.byte_rate));
+                        deferred_log_push(&s_log_refilled,
+                                          (uint32_t)((uint64_t)s_plc.concealed_frames * frame_bytes * 1000 / s_jitter_buf.byte_rate), 0);
+                        ringbuffer_mode_change(RINGBUFFER_MODE_CONCEALING, RINGBUFFER_MODE_PROCESSING);
+                    } else if ((uint64_t)s_plc.concealed_frames * frame_bytes * 1000 >= (uint64_t)s_jitter_buf.byte_rate * PLC_MAX_MS) {
+                        deferred_log_push(&s_log_still_empty, 0, 0);
+                        telemetry_record(TELEMETRY_HIST_UNDERFLOW_MS, PLC_MAX_MS);
+                        telemetry_count(TELEMETRY_CNT_PREFETCH_RESTARTS, 1);
+                        ringbuffer_mode_change(RINGBUFFER_MODE_CONCEALING, RINGBUFFER_MODE_PREFETCHING);
+                        break;
+                    } else {
+                        /* keep the DMA fed with audio synthesized from the last played frames */
+                        plc_conceal(&s_plc, s_pcm_out, s_pcm_ring.slab_size / frame_bytes);
+                        telemetry_count(TELEMETRY_CNT_FRAMES_CONCEALED, s_pcm_ring.slab_size / frame_bytes);
+                        bt_i2s_deadline_check();
+                    #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
+                        dac_continuous_write(tx_chan, (uint8_t *)s_pcm_out, s_pcm_ring.slab_size, &bytes_written, -1);
+                    #else
+                        i2s_channel_write(tx_chan, s_pcm_out, s_pcm_ring.slab_size, &bytes_written, portMAX_DELAY);
+                    #endif
+                        continue;
+                    }
+                }
+
+                /* take the oldest slab, written whole to the I2S driver */
+                if ((data = pcm_ring_peek()) == NULL) {
+                    /* a wake-up left over from an earlier slab must not end the wait early */
+                    ulTaskNotifyTake(pdTRUE, 0);
+                    vTaskSetTimeOutState(&wait_timeout);
+                    wait_ticks = slab_wait_ticks;
+                    for (;;) {
+                        atomic_store(&s_pcm_ring.consumer_waiting, true);
+                        /* check again, the producer may have published a slab in the meantime */
+                        if ((data = pcm_ring_peek()) != NULL || !atomic_load(&s_streaming) ||
+                            xTaskCheckForTimeOut(&wait_timeout, &wait_ticks) != pdFALSE) {
+                            break;
+                        }
+                        ulTaskNotifyTake(pdTRUE, wait_ticks);
+                    }
+                    atomic_store(&s_pcm_ring.consumer_waiting, false);
+                }
+                if (data == NULL && !atomic_load(&s_streaming)) {
+                    continue;
+                }
+                if (data == NULL) {
+                    deferred_log_push(&s_log_underflow, 0, 0);
+                    /* from processing or dropping, the producer may switch between both meanwhile */
+                    do {
+                        mode = atomic_load(&ringbuffer_mode);
+                    } while (!ringbuffer_mode_change(mode, RINGBUFFER_MODE_CONCEALING));
+                    telemetry_count(TELEMETRY_CNT_UNDERFLOWS, 1);
+                    continue;
+                }
+                item_size = pcm_ring_filled_bytes();
+                s_fill_avg_q4 += ((int32_t)(item_size << 4) - s_fill_avg_q4) >> 6;
+                telemetry_record_fill(TELEMETRY_HIST_FILL_READ, item_size, RINGBUF_HIGHEST_WATER_LEVEL);
+                telemetry_record(TELEMETRY_HIST_QUEUE_MS, pcm_ring_peek_age_ms());
+
+            #ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+                /* keep the ring centred on the jitter target by slightly resampling each slab */
+                asrc_update(&s_asrc, pcm_ring_filled_bytes() / frame_bytes, s_jitter_buf.target_bytes / frame_bytes);
+                out_size = asrc_process(&s_asrc, (const int16_t *)data, s_pcm_ring.slab_size / frame_bytes, s_pcm_out) * frame_bytes;
+                pcm_ring_release();
+                data = (uint8_t *)s_pcm_out;
+            #else
+                out_size = s_pcm_ring.slab_size;
+            #endif
+                plc_resume(&s_plc, (int16_t *)data, out_size / frame_bytes);
+                plc_record(&s_plc, (const int16_t *)data, out_size / frame_bytes);
+
+                bt_i2s_deadline_check();
+                write_start_us = esp_timer_get_time();
             #ifdef CONFIG_EXAMPLE_A2DP_SINK_OUTPUT_INTERNAL_DAC
-                dac_continuous_write(tx_chan, data, item_size, &bytes_written, -1);
+                dac_continuous_write(tx_chan, data, out_size, &bytes_written, -1);
             #else
-                i2s_channel_write(tx_chan, data, item_size, &bytes_written, portMAX_DELAY);
+                i2s_channel_write(tx_chan, data, out_size, &bytes_written, portMAX_DELAY);
+            #endif
+                telemetry_record(TELEMETRY_HIST_I2S_WRITE_US, (uint32_t)(esp_timer_get_time() - write_start_us));
+            #ifndef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+                pcm_ring_release();
             #endif
-                vRingbufferReturnItem(s_ringbuf_i2s, (void *)data);
             }
+            xEventGroupSetBits(s_i2s_state, BT_I2S_PARKED_BIT);
         }
     }
 }
 
+static void bt_i2s_deadline_check(void)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t frame_bytes = s_pcm_channels * sizeof(int16_t);
+    int64_t budget_us;
+
+    /* the DMA queue holds dma_desc_num buffers, it drains if the next write takes longer */
+    budget_us = (int64_t)s_latency.dma_desc_num * s_latency.dma_frame_num * frame_bytes * 1000000 / s_jitter_buf.byte_rate;
+    if (s_i2s_last_write_us != 0 && now - s_i2s_last_write_us > budget_us) {
+        telemetry_count(TELEMETRY_CNT_DEADLINE_MISSES, 1);
+        deferred_log_push(&s_log_deadline_miss, (uint32_t)(now - s_i2s_last_write_us - budget_us), 0);
+    }
+    s_i2s_last_write_us = now;
+}
+
+static bool ringbuffer_mode_change(uint32_t from, uint32_t to)
+{
+    uint_fast32_t expected = from;
+
+    if (!atomic_compare_exchange_strong(&ringbuffer_mode, &expected, to)) {
+        return false;
+    }
+    /* the I2S task waits on its semaphore while prefetching */
+    if (from == RINGBUFFER_MODE_PREFETCHING && pdFALSE == xSemaphoreGive(s_i2s_write_semaphore)) {
+        deferred_log_push(&s_log_give_failed, 0, 0);
+    }
+    return true;
+}
+
+static TickType_t bt_i2s_slab_wait_ticks(void)
+{
+    uint32_t sample_rate = s_jitter_buf.byte_rate / (s_pcm_channels * sizeof(int16_t));
+    uint32_t wait_ms;
+    TickType_t ticks;
+
+    /* concealment must start while the DMA still plays queued audio, before auto_clear fills the
+     * gap with silence; the tick period bounds the resolution of the wait */
+    wait_ms = s_latency.dma_desc_num * s_latency.dma_frame_num * 1000 / (2 * sample_rate);
+    ticks = pdMS_TO_TICKS(wait_ms);
+    return (ticks > 0) ? ticks : 1;
+}
+
+static void bt_i2s_engine_init(void)
+{
+    if (s_bt_i2s_task_handle) {
+        return;
+    }
+    atomic_store(&s_streaming, false);
+    atomic_store(&s_producer_busy, false);
+    s_i2s_state = xEventGroupCreateStatic(&s_i2s_state_buffer);
+    xEventGroupSetBits(s_i2s_state, BT_I2S_PARKED_BIT);
+    s_i2s_write_semaphore = xSemaphoreCreateBinaryStatic(&s_i2s_write_semaphore_buffer);
+    s_bt_i2s_task_handle = xTaskCreateStaticPinnedToCore(bt_i2s_task_handler, "BtI2STask", BT_I2S_TASK_STACK_SIZE, NULL,
+                                                         BT_I2S_TASK_PRIORITY, s_bt_i2s_task_stack, &s_bt_i2s_task_buffer,
+                                                         BT_I2S_TASK_CORE);
+}
+
 /********************************
  * EXTERNAL FUNCTION DEFINITIONS
  *******************************/
 
 bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback)
 {
-    ESP_LOGD(BT_APP_CORE_TAG, "%s event: 0x%x, param len: %d", __func__, event, param_len);
+    return bt_app_work_dispatch_prio(p_cback, event, p_params, param_len, p_copy_cback, BT_APP_PRIO_NORMAL);
+}
 
-    bt_app_msg_t msg;
-    memset(&msg, 0, sizeof(bt_app_msg_t));
+bool bt_app_work_dispatch_prio(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len,
+                               bt_app_copy_cb_t p_copy_cback, bt_app_prio_t prio)
+{
+    ESP_LOGD(BT_APP_CORE_TAG, "%s event: 0x%x, param len: %d, priority: %d", __func__, event, param_len, prio);
 
-    msg.sig = BT_APP_SIG_WORK_DISPATCH;
-    msg.event = event;
-    msg.cb = p_cback;
+    if (prio >= BT_APP_PRIO_NUM) {
+        prio = BT_APP_PRIO_NORMAL;
+    }
+    return bt_app_dispatch(p_cback, event, p_params, param_len, p_copy_cback, prio, NULL);
+}
 
-    if (param_len == 0) {
-        return bt_app_send_msg(&msg);
-    } else if (p_params && param_len > 0) {
-        if ((msg.param = malloc(param_len)) != NULL) {
-            memcpy(msg.param, p_params, param_len);
-            /* check if caller has provided a copy callback to do the deep copy */
-            if (p_copy_cback) {
-                p_copy_cback(msg.param, p_params, param_len);
-            }
-            return bt_app_send_msg(&msg);
+bool bt_app_work_dispatch_coalesced(bt_app_cb_t p_cback, uint16_t event, uint32_t key, void *p_params, int param_len,
+                                    bt_app_prio_t prio)
+{
+    bt_app_coalesce_entry_t *entry = NULL;
+
+    if (prio >= BT_APP_PRIO_NUM) {
+        prio = BT_APP_PRIO_NORMAL;
+    }
+    if (p_params == NULL || param_len <= 0 || (size_t)param_len > sizeof(bt_app_msg_param_t)) {
+        return false;
+    }
+
+    /* a message of the same kind is still queued: only the latest parameter survives */
+    taskENTER_CRITICAL(&s_bt_app_coalesce_lock);
+    for (int i = 0; i < BT_APP_COALESCE_NUM; i++) {
+        entry = &s_bt_app_coalesce[i];
+        if (entry->slot && entry->cb == p_cback && entry->event == event && entry->key == key) {
+            memcpy(entry->slot, p_params, param_len);
+            taskEXIT_CRITICAL(&s_bt_app_coalesce_lock);
+            atomic_fetch_add_explicit(&s_bt_app_work_queues[prio].coalesced, 1, memory_order_relaxed);
+            return true;
         }
     }
+    taskEXIT_CRITICAL(&s_bt_app_coalesce_lock);
 
-    return false;
+    return bt_app_dispatch(p_cback, event, p_params, param_len, NULL, prio, &key);
+}
+
+void bt_app_get_dispatch_stats(bt_app_prio_t prio, bt_app_dispatch_stats_t *stats)
+{
+    bt_app_work_queue_t *wq = &s_bt_app_work_queues[prio];
+
+    stats->dispatched = atomic_load_explicit(&wq->dispatched, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&wq->dropped, memory_order_relaxed);
+    stats->coalesced = atomic_load_explicit(&wq->coalesced, memory_order_relaxed);
+    stats->depth = wq->queue ? uxQueueMessagesWaiting(wq->queue) : 0;
+    stats->max_depth = atomic_load_explicit(&wq->max_depth, memory_order_relaxed);
 }
 
 void bt_app_task_start_up(void)
 {
-    s_bt_app_task_queue = xQueueCreate(10, sizeof(bt_app_msg_t));
-    xTaskCreate(bt_app_task_handler, "BtAppTask", 3072, NULL, 10, &s_bt_app_task_handle);
+    _lock_acquire(&s_latency_lock);
+    if (!s_latency_held) {
+        bt_audio_latency_apply();
+    }
+    _lock_release(&s_latency_lock);
+    bt_i2s_engine_init();
+    if (s_bt_app_free_slots == NULL) {
+        s_bt_app_free_slots = xQueueCreateStatic(BT_APP_MSG_SLOT_NUM, sizeof(bt_app_msg_slot_t *),
+                                                 s_bt_app_free_slots_storage, &s_bt_app_free_slots_buffer);
+    }
+    xQueueReset(s_bt_app_free_slots);
+    for (int i = 0; i < BT_APP_MSG_SLOT_NUM; i++) {
+        bt_app_msg_slot_t *slot = &s_bt_app_msg_slots[i];
+        xQueueSend(s_bt_app_free_slots, &slot, 0);
+    }
+    for (int prio = 0; prio < BT_APP_PRIO_NUM; prio++) {
+        bt_app_work_queue_t *wq = &s_bt_app_work_queues[prio];
+        wq->queue = xQueueCreateStatic(s_bt_app_work_queue_len[prio], sizeof(bt_app_msg_t),
+                                       wq->storage, &wq->queue_buffer);
+    }
+    s_bt_app_work_pending = xSemaphoreCreateCountingStatic(BT_APP_TASK_QUEUE_LEN, 0, &s_bt_app_work_pending_buffer);
+    xTaskCreatePinnedToCore(bt_app_task_handler, "BtAppTask", BT_APP_TASK_STACK_SIZE, NULL, BT_APP_TASK_PRIORITY,
+                            &s_bt_app_task_handle, BT_APP_TASK_CORE);
 }
 
 void bt_app_task_shut_down(void)
@@ -192,76 +919,260 @@ void bt_app_task_shut_down(void)
         vTaskDelete(s_bt_app_task_handle);
         s_bt_app_task_handle = NULL;
     }
-    if (s_bt_app_task_queue) {
-        vQueueDelete(s_bt_app_task_queue);
-        s_bt_app_task_queue = NULL;
+    /* statically allocated, only the handles are released */
+    for (int prio = 0; prio < BT_APP_PRIO_NUM; prio++) {
+        if (s_bt_app_work_queues[prio].queue) {
+            vQueueDelete(s_bt_app_work_queues[prio].queue);
+            s_bt_app_work_queues[prio].queue = NULL;
+        }
+    }
+    if (s_bt_app_work_pending) {
+        vSemaphoreDelete(s_bt_app_work_pending);
+        s_bt_app_work_pending = NULL;
     }
 }
 
 void bt_i2s_task_start_up(void)
 {
-    ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data empty! mode changed: RINGBUFFER_MODE_PREFETCHING");
-    ringbuffer_mode = RINGBUFFER_MODE_PREFETCHING;
-    if ((s_i2s_write_semaphore = xSemaphoreCreateBinary()) == NULL) {
-        ESP_LOGE(BT_APP_CORE_TAG, "%s, Semaphore create failed", __func__);
+    if (atomic_load(&s_streaming)) {
         return;
     }
-    if ((s_ringbuf_i2s = xRingbufferCreate(RINGBUF_HIGHEST_WATER_LEVEL, RINGBUF_TYPE_BYTEBUF)) == NULL) {
-        ESP_LOGE(BT_APP_CORE_TAG, "%s, ringbuffer create failed", __func__);
-        return;
-    }
-    xTaskCreate(bt_i2s_task_handler, "BtI2STask", 2048, NULL, configMAX_PRIORITIES - 3, &s_bt_i2s_task_handle);
+    ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data empty! mode changed: RINGBUFFER_MODE_PREFETCHING");
+    atomic_store(&ringbuffer_mode, RINGBUFFER_MODE_PREFETCHING);
+    jitter_buffer_reset();
+    plc_init(&s_plc, s_pcm_channels);
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+    asrc_init(&s_asrc, s_pcm_channels);
+#endif
+    s_pcm_ring.fill = 0;
+    atomic_store(&s_pcm_ring.written, 0);
+    s_fill_avg_q4 = (int32_t)(s_jitter_buf.target_bytes << 4);
+    atomic_store(&s_pcm_ring.head, 0);
+    atomic_store(&s_pcm_ring.tail, 0);
+    atomic_store(&s_pcm_ring.consumer_waiting, false);
+    /* discard a start left over from the previous stream, then open the ring to the producer */
+    xSemaphoreTake(s_i2s_write_semaphore, 0);
+    atomic_store(&s_streaming, true);
 }
 
-void bt_i2s_task_shut_down(void)
+bool bt_i2s_task_shut_down(void)
 {
-    if (s_bt_i2s_task_handle) {
-        vTaskDelete(s_bt_i2s_task_handle);
-        s_bt_i2s_task_handle = NULL;
+    if (!atomic_load(&s_streaming)) {
+        return false;
     }
-    if (s_ringbuf_i2s) {
-        vRingbufferDelete(s_ringbuf_i2s);
-        s_ringbuf_i2s = NULL;
+    atomic_store(&s_streaming, false);
+
+    /* a packet already past the streaming check is finished before the ring is reused */
+    while (atomic_load(&s_producer_busy)) {
+        vTaskDelay(1);
     }
-    if (s_i2s_write_semaphore) {
-        vSemaphoreDelete(s_i2s_write_semaphore);
-        s_i2s_write_semaphore = NULL;
+
+    /* wake the I2S task up if it waits for data, and let it park before the ring is reused */
+    xTaskNotifyGive(s_bt_i2s_task_handle);
+    if (!(xEventGroupWaitBits(s_i2s_state, BT_I2S_PARKED_BIT, pdFALSE, pdTRUE,
+                              pdMS_TO_TICKS(BT_I2S_PARK_TIMEOUT_MS)) & BT_I2S_PARKED_BIT)) {
+        ESP_LOGW(BT_APP_CORE_TAG, "%s, I2S task still busy", __func__);
     }
+    return true;
 }
 
 size_t write_ringbuf(const uint8_t *data, size_t size)
 {
     size_t item_size = 0;
-    BaseType_t done = pdFALSE;
+    size_t done = 0;
+    size_t drop_frames = 0;
 
-    // Ringbuffer is full, packet dropped
-    if (ringbuffer_mode == RINGBUFFER_MODE_DROPPING) {
-        ESP_LOGW(BT_APP_CORE_TAG, "ringbuffer is full, drop this packet!");
-        vRingbufferGetInfo(s_ringbuf_i2s, NULL, NULL, NULL, NULL, &item_size);
-        if (item_size <= RINGBUF_PREFETCH_WATER_LEVEL) {
-            ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data decreased! mode changed: RINGBUFFER_MODE_PROCESSING");
-            ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
-        }
+    /* flagged before the stopped check, so that a shut down either sees it or stops this packet */
+    atomic_store(&s_producer_busy, true);
+    if (!atomic_load(&s_streaming)) {
+        atomic_store(&s_producer_busy, false);
         return 0;
     }
 
-    done = xRingbufferSend(s_ringbuf_i2s, (void *)data, size, (TickType_t)0);
+    jitter_buffer_update(size);
+    telemetry_count(TELEMETRY_CNT_PACKETS, 1);
+    telemetry_count(TELEMETRY_CNT_BYTES, size);
+
+    // Ringbuffer above target, a few frames of each packet are dropped until it is back on target
+    if (atomic_load(&ringbuffer_mode) == RINGBUFFER_MODE_DROPPING) {
+        item_size = pcm_ring_filled_bytes();
+        if (item_size <= s_jitter_buf.target_bytes) {
+            if (ringbuffer_mode_change(RINGBUFFER_MODE_DROPPING, RINGBUFFER_MODE_PROCESSING)) {
+                deferred_log_push(&s_log_decreased, 0, 0);
+                telemetry_record(TELEMETRY_HIST_OVERFLOW_MS, (uint32_t)((esp_timer_get_time() - s_overflow_start_us) / 1000));
+            }
+        } else {
+            drop_frames = (item_size - s_jitter_buf.target_bytes) / (s_pcm_channels * sizeof(int16_t));
+            if (drop_frames > PCM_TRIM_MAX_FRAMES) {
+                drop_frames = PCM_TRIM_MAX_FRAMES;
+            }
+        }
+    }
+
+    done = pcm_ring_write_trimmed(data, size, drop_frames);
 
+    // Ringbuffer is full, packet dropped
     if (!done) {
-        ESP_LOGW(BT_APP_CORE_TAG, "ringbuffer overflowed, ready to decrease data! mode changed: RINGBUFFER_MODE_DROPPING");
-        ringbuffer_mode = RINGBUFFER_MODE_DROPPING;
+        deferred_log_push(&s_log_packet_dropped, 0, 0);
+        telemetry_count(TELEMETRY_CNT_PACKETS_DROPPED, 1);
     }
+    telemetry_record_fill(TELEMETRY_HIST_FILL_WRITE, pcm_ring_filled_bytes(), RINGBUF_HIGHEST_WATER_LEVEL);
 
-    if (ringbuffer_mode == RINGBUFFER_MODE_PREFETCHING) {
-        vRingbufferGetInfo(s_ringbuf_i2s, NULL, NULL, NULL, NULL, &item_size);
-        if (item_size >= RINGBUF_PREFETCH_WATER_LEVEL) {
-            ESP_LOGI(BT_APP_CORE_TAG, "ringbuffer data increased! mode changed: RINGBUFFER_MODE_PROCESSING");
-            ringbuffer_mode = RINGBUFFER_MODE_PROCESSING;
-            if (pdFALSE == xSemaphoreGive(s_i2s_write_semaphore)) {
-                ESP_LOGE(BT_APP_CORE_TAG, "semphore give failed");
-            }
+    // Trimming only starts from processing, a prefetch or a concealment ends on its own once refilled
+    if ((!done || pcm_ring_filled_bytes() > 2 * s_jitter_buf.target_bytes) &&
+        ringbuffer_mode_change(RINGBUFFER_MODE_PROCESSING, RINGBUFFER_MODE_DROPPING)) {
+        deferred_log_push(&s_log_overflowed, 0, 0);
+        s_overflow_start_us = esp_timer_get_time();
+        telemetry_count(TELEMETRY_CNT_OVERFLOWS, 1);
+    }
+
+    if (atomic_load(&ringbuffer_mode) == RINGBUFFER_MODE_PREFETCHING) {
+        item_size = pcm_ring_filled_bytes();
+        if (item_size >= s_jitter_buf.target_bytes &&
+            ringbuffer_mode_change(RINGBUFFER_MODE_PREFETCHING, RINGBUFFER_MODE_PROCESSING)) {
+            deferred_log_push(&s_log_increased, s_jitter_buf.target_bytes, 0);
         }
     }
 
-    return done ? size : 0;
+    atomic_store(&s_producer_busy, false);
+    return done;
+}
+
+void bt_audio_latency_profile_from_ms(uint32_t latency_ms, bt_audio_latency_profile_t *profile)
+{
+    uint32_t chunk_ms_x10;
+    uint32_t dma_frames;
+    uint32_t dma_ms;
+    uint32_t ring_ms;
+
+    if (latency_ms < BT_AUDIO_LATENCY_MIN_MS) {
+        latency_ms = BT_AUDIO_LATENCY_MIN_MS;
+    } else if (latency_ms > BT_AUDIO_LATENCY_MAX_MS) {
+        latency_ms = BT_AUDIO_LATENCY_MAX_MS;
+    }
+    profile->latency_ms = latency_ms;
+
+    /* small writes for low latency, large ones to spare CPU wake-ups when buffers are deep */
+    if (latency_ms < 60) {
+        profile->chunk_frames = BT_AUDIO_CHUNK_FRAMES_MIN;
+    } else if (latency_ms < 150) {
+        profile->chunk_frames = 2 * BT_AUDIO_CHUNK_FRAMES_MIN;
+    } else {
+        profile->chunk_frames = BT_AUDIO_CHUNK_FRAMES_MAX;
+    }
+    chunk_ms_x10 = profile->chunk_frames * 10000 / PCM_REFERENCE_RATE;
+
+    /* a fifth of the latency sits in the DMA, in whole descriptors of one chunk each */
+    profile->dma_frame_num = profile->chunk_frames;
+    dma_frames = latency_ms / 5 * PCM_REFERENCE_RATE / 1000;
+    profile->dma_desc_num = (dma_frames + profile->chunk_frames - 1) / profile->chunk_frames;
+    if (profile->dma_desc_num < 2) {
+        profile->dma_desc_num = 2;
+    } else if (profile->dma_desc_num > 16) {
+        profile->dma_desc_num = 16;
+    }
+    dma_ms = profile->dma_desc_num * chunk_ms_x10 / 10;
+
+    /* the ringbuffer holds the rest, with room to absorb jitter up to the ring capacity */
+    ring_ms = PCM_SLAB_NUM * chunk_ms_x10 / 10;
+    profile->jb_default_ms = (latency_ms > dma_ms) ? latency_ms - dma_ms : 0;
+    if (profile->jb_default_ms < 2 * chunk_ms_x10 / 10) {
+        profile->jb_default_ms = 2 * chunk_ms_x10 / 10;
+    }
+    if (profile->jb_default_ms > ring_ms * 3 / 4) {
+        profile->jb_default_ms = ring_ms * 3 / 4;
+    }
+    profile->jb_min_ms = profile->jb_default_ms / 2;
+    if (profile->jb_min_ms < 2 * chunk_ms_x10 / 10) {
+        profile->jb_min_ms = 2 * chunk_ms_x10 / 10;
+    }
+    profile->jb_max_ms = profile->jb_default_ms * 5 / 2;
+    if (profile->jb_max_ms > ring_ms * 3 / 4) {
+        profile->jb_max_ms = ring_ms * 3 / 4;
+    }
+    if (profile->jb_max_ms < profile->jb_default_ms) {
+        profile->jb_max_ms = profile->jb_default_ms;
+    }
+}
+
+void bt_audio_set_latency_ms(uint32_t latency_ms)
+{
+    _lock_acquire(&s_latency_lock);
+    s_latency_requested_ms = latency_ms;
+    /* the I2S channel and the ring are sized from the held profile until it is released */
+    if (!s_latency_held) {
+        bt_audio_latency_apply();
+    } else {
+        ESP_LOGI(BT_APP_CORE_TAG, "latency of %"PRIu32" ms applied from the next connection", latency_ms);
+    }
+    _lock_release(&s_latency_lock);
+}
+
+void bt_audio_latency_hold(bt_audio_latency_profile_t *profile)
+{
+    _lock_acquire(&s_latency_lock);
+    s_latency_held = true;
+    *profile = s_latency;
+    _lock_release(&s_latency_lock);
+}
+
+void bt_audio_latency_release(void)
+{
+    _lock_acquire(&s_latency_lock);
+    s_latency_held = false;
+    /* a latency requested while the output was running takes effect now */
+    if (s_latency_requested_ms != s_latency.latency_ms) {
+        bt_audio_latency_apply();
+    }
+    _lock_release(&s_latency_lock);
+}
+
+void bt_audio_get_latency_profile(bt_audio_latency_profile_t *profile)
+{
+    _lock_acquire(&s_latency_lock);
+    *profile = s_latency;
+    _lock_release(&s_latency_lock);
+}
+
+void bt_audio_set_output_delay_frames(uint32_t frames)
+{
+    s_output_delay_frames = frames;
+}
+
+uint32_t bt_audio_get_pipeline_delay_us(void)
+{
+    uint32_t frame_bytes = s_pcm_channels * sizeof(int16_t);
+    uint32_t sample_rate = s_jitter_buf.byte_rate / frame_bytes;
+    uint32_t latency_ms;
+    uint64_t frames;
+
+    /* nothing measured outside a connection, the profile target is the best estimate */
+    if (!atomic_load(&s_streaming)) {
+        _lock_acquire(&s_latency_lock);
+        latency_ms = s_latency.latency_ms;
+        _lock_release(&s_latency_lock);
+        return latency_ms * 1000 + (uint32_t)((uint64_t)s_output_delay_frames * 1000000 / sample_rate);
+    }
+
+    /* ringbuffer, then the whole DMA queue, then the resampler and codec filter history */
+    frames = (uint32_t)(s_fill_avg_q4 >> 4) / frame_bytes;
+    frames += s_latency.dma_desc_num * s_latency.dma_frame_num;
+#ifdef CONFIG_EXAMPLE_A2DP_SINK_ASRC
+    frames += 2;
+#endif
+    frames += s_output_delay_frames;
+
+    return (uint32_t)(frames * 1000000 / sample_rate);
+}
+
+void bt_i2s_set_pcm_format(int sample_rate, int ch_count)
+{
+    /* the producer and the I2S task read the format without a lock: both must be parked */
+    if (atomic_load(&s_streaming)) {
+        ESP_LOGE(BT_APP_CORE_TAG, "%s, audio engine running, format unchanged", __func__);
+        return;
+    }
+    s_jitter_buf.byte_rate = (uint32_t)sample_rate * ch_count * 2;
+    s_pcm_channels = ch_count;
+    jitter_buffer_reset();
 }
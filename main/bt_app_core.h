@@ -25,6 +25,42 @@
  */
 typedef void (* bt_app_cb_t) (uint16_t event, void *param);
 
+/* bounds of the target latency */
+#define BT_AUDIO_LATENCY_MIN_MS      (20)
+#define BT_AUDIO_LATENCY_MAX_MS      (250)
+
+/* bounds of the frames per I2S write, one DMA buffer and one ringbuffer slab */
+#define BT_AUDIO_CHUNK_FRAMES_MIN    (120)
+#define BT_AUDIO_CHUNK_FRAMES_MAX    (360)
+
+/* buffering configuration derived from a single target latency */
+typedef struct {
+    uint32_t latency_ms;       /*!< target end-to-end buffering */
+    uint32_t dma_desc_num;     /*!< I2S DMA descriptors */
+    uint32_t dma_frame_num;    /*!< frames per I2S DMA descriptor */
+    uint32_t chunk_frames;     /*!< frames per I2S write and per ringbuffer slab */
+    uint32_t jb_default_ms;    /*!< jitter buffer target before any arrival statistics */
+    uint32_t jb_min_ms;        /*!< lowest jitter buffer target */
+    uint32_t jb_max_ms;        /*!< highest jitter buffer target */
+} bt_audio_latency_profile_t;
+
+/* priority classes of the dispatched work, each one has its own queue */
+typedef enum {
+    BT_APP_PRIO_HIGH = 0,      /*!< control-critical: audio state, codec configuration, volume */
+    BT_APP_PRIO_NORMAL,        /*!< connection management and everything else */
+    BT_APP_PRIO_LOW,           /*!< bulk: metadata, notifications, cover art */
+    BT_APP_PRIO_NUM,
+} bt_app_prio_t;
+
+/* statistics of a priority class */
+typedef struct {
+    uint32_t dispatched;       /*!< messages queued */
+    uint32_t dropped;          /*!< messages lost, queue or slot pool full */
+    uint32_t coalesced;        /*!< messages merged into one still queued */
+    uint32_t depth;            /*!< messages waiting now */
+    uint32_t max_depth;        /*!< highest number of messages waiting */
+} bt_app_dispatch_stats_t;
+
 /* message to be sent */
 typedef struct {
     uint16_t       sig;      /*!< signal to bt_app_task */
@@ -33,8 +69,13 @@ typedef struct {
     void           *param;   /*!< parameter area needs to be last */
 } bt_app_msg_t;
 
+/* bytes following the parameter of a message, for the data referenced by the parameter */
+#define BT_APP_MSG_EXTRA_SIZE        (256)
+
 /**
- * @brief  parameter deep-copy function to be customized
+ * @brief  parameter deep-copy function to be customized, the parameter is copied into a
+ *         message slot and the data it points to can be stored right after it, in at most
+ *         BT_APP_MSG_EXTRA_SIZE bytes starting at (uint8_t *)p_dest + len
  *
  * @param [out] p_dest  pointer to destination data
  * @param [in]  p_src   pointer to source data
@@ -43,7 +84,8 @@ typedef struct {
 typedef void (* bt_app_copy_cb_t) (void *p_dest, void *p_src, int len);
 
 /**
- * @brief  work dispatcher for the application task
+ * @brief  work dispatcher for the application task, never blocks: the message is dropped and
+ *         counted when its queue is full
  *
  * @param [in] p_cback       callback function
  * @param [in] event         event id
@@ -56,7 +98,49 @@ typedef void (* bt_app_copy_cb_t) (void *p_dest, void *p_src, int len);
 bool bt_app_work_dispatch(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len, bt_app_copy_cb_t p_copy_cback);
 
 /**
- * @brief  start up the application task
+ * @brief  work dispatcher for the application task, with a priority class: pending work of a
+ *         higher class is always handled first, bt_app_work_dispatch uses BT_APP_PRIO_NORMAL
+ *
+ * @param [in] p_cback       callback function
+ * @param [in] event         event id
+ * @param [in] p_params      callback paramters
+ * @param [in] param_len     parameter length in byte
+ * @param [in] p_copy_cback  parameter deep-copy function
+ * @param [in] prio          priority class
+ *
+ * @return  true if work dispatch successfully, false otherwise
+ */
+bool bt_app_work_dispatch_prio(bt_app_cb_t p_cback, uint16_t event, void *p_params, int param_len,
+                               bt_app_copy_cb_t p_copy_cback, bt_app_prio_t prio);
+
+/**
+ * @brief  work dispatcher for events where only the latest one matters: while a message with
+ *         the same callback, event and key is still queued, its parameter is replaced instead
+ *         of queueing a new message
+ *
+ * @param [in] p_cback       callback function
+ * @param [in] event         event id
+ * @param [in] key           distinguishes events of the same id that must not be merged
+ * @param [in] p_params      callback paramters, without any deep copy
+ * @param [in] param_len     parameter length in byte
+ * @param [in] prio          priority class
+ *
+ * @return  true if work dispatch or merged successfully, false otherwise
+ */
+bool bt_app_work_dispatch_coalesced(bt_app_cb_t p_cback, uint16_t event, uint32_t key, void *p_params, int param_len,
+                                    bt_app_prio_t prio);
+
+/**
+ * @brief  get the statistics of a priority class of the work dispatcher
+ *
+ * @param [in]  prio   priority class
+ * @param [out] stats  statistics of the class
+ */
+void bt_app_get_dispatch_stats(bt_app_prio_t prio, bt_app_dispatch_stats_t *stats);
+
+/**
+ * @brief  start up the application task and allocate the audio engine, which stays idle
+ *         until a stream starts
  */
 void bt_app_task_start_up(void);
 
@@ -66,14 +150,79 @@ void bt_app_task_start_up(void);
 void bt_app_task_shut_down(void);
 
 /**
- * @brief  start up the is task
+ * @brief  move the audio engine to the streaming state, nothing is allocated
  */
 void bt_i2s_task_start_up(void);
 
 /**
- * @brief  shut down the I2S task
+ * @brief  move the audio engine back to the idle state, nothing is freed. The I2S task is parked
+ *         on return: the output channel may be reconfigured
+ *
+ * @return  true if a stream was running
+ */
+bool bt_i2s_task_shut_down(void);
+
+/**
+ * @brief  derive the DMA depth, chunk size and jitter buffer watermarks from a target latency
+ *
+ * @param [in]  latency_ms  target end-to-end buffering in milliseconds
+ * @param [out] profile     derived configuration
+ */
+void bt_audio_latency_profile_from_ms(uint32_t latency_ms, bt_audio_latency_profile_t *profile);
+
+/**
+ * @brief  select the latency of the audio pipeline, applied at once while the profile is not
+ *         held, from the next connection otherwise
+ *
+ * @param [in] latency_ms  target end-to-end buffering in milliseconds
+ */
+void bt_audio_set_latency_ms(uint32_t latency_ms);
+
+/**
+ * @brief  hold the current latency profile while the I2S channel is built from it, a latency
+ *         selected meanwhile is deferred until the profile is released
+ *
+ * @param [out] profile  profile the I2S channel must be built from
+ */
+void bt_audio_latency_hold(bt_audio_latency_profile_t *profile);
+
+/**
+ * @brief  release the latency profile once the I2S output is stopped, a deferred latency
+ *         takes effect
+ */
+void bt_audio_latency_release(void);
+
+/**
+ * @brief  get the latency profile of the current (or next) connection
+ *
+ * @param [out] profile  latency profile in use
+ */
+void bt_audio_get_latency_profile(bt_audio_latency_profile_t *profile);
+
+/**
+ * @brief  set the delay added after the I2S output, e.g. by the codec interpolation filters
+ *
+ * @param [in] frames  delay in frames at the stream sample rate
+ */
+void bt_audio_set_output_delay_frames(uint32_t frames);
+
+/**
+ * @brief  get the current end-to-end delay of the audio pipeline, from the ringbuffer
+ *         fill level, the I2S DMA depth and the output delay
+ *
+ * @return  delay in microseconds
+ */
+uint32_t bt_audio_get_pipeline_delay_us(void);
+
+/**
+ * @brief  set the PCM format of the incoming stream, used to convert buffer levels into time.
+ *         Only while the audio engine is idle: stop it with bt_i2s_task_shut_down() first, then
+ *         reconfigure the output channel, set the format and restart the stream.
+ *
+ * @param [in] sample_rate  sample rate in Hz
+ * @param [in] ch_count     number of channels (16-bit samples)
  */
-void bt_i2s_task_shut_down(void);
+void bt_i2s_set_pcm_format(int sample_rate, int ch_count);
 
 /**
  * @brief  write data to ringbuffer
@@ -175,6 +175,15 @@ const static tad5212_REG_DAC_CH2A_CFG0_t COMMON_CFG_DAC_CH2A_CFG0 =
     .dac_ch2a_dvol              = TAD5212_DAC_MIN_VOLUME,  /* Channel 2A digital volume control */
 };
 
+const static tad5212_REG_DSP_CFG1_t COMMON_CFG_DSP_CFG1 = 
+{
+    .dac_dsp_dvol_gang          = 0x0,  /* Independent DAC channel volumes */
+    .dac_dsp_disable_soft_step  = 0x0,  /* Soft-stepping enabled */
+    .dac_dsp_bq_cfg             = 0x3,  /* 3 biquads per DAC channel: crossover and EQ */
+    .dac_dsp_hpf_sel            = 0x1,  /* Default high-pass filter */
+    .dac_dsp_deci_filt          = 0x0,  /* Linear phase interpolation filter */
+};
+
 const static tad5212_REG_CH_EN_t COMMON_CFG_CH_EN = 
 {
     .in_ch1_en                 = 0x0,  /* ADC Channel 1 disabled */
@@ -197,4 +206,54 @@ const static tad5212_REG_PWR_CFG_t COMMON_CFG_PWR_CFG =
     .adc_pdz                    = 0x0,  /* Power down all ADCs */
 };
 
+/*** Initialization sequences *********************************************************************/
+
+/* Reset and configuration common to every topology, DACs muted */
+const static tad5212_init_step_t COMMON_CFG_INIT_SEQUENCE[] =
+{
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_SW_RESET,          COMMON_CFG_SW_RESET,            10),    /* Reset settle time */
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_DEV_MISC_CFG,      COMMON_CFG_DEV_MISC_CFG_P0,     10),    /* AREG and VREF settle time */
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_DAC_CFG_A0,        COMMON_CFG_DAC_CFG_A0,          0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_MISC_CFG0,         COMMON_CFG_MISC_CFG0,           0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_INTF_CFG1,         COMMON_CFG_INTF_CFG1,           0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_ASI_CFG1,          COMMON_CFG_ASI_CFG1,            0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_PASI_CFG0,         COMMON_CFG_PASI_CFG0,           0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_PASI_RX_CH1_CFG,   COMMON_CFG_PASI_RX_CH1_CFG,     0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_PASI_RX_CH2_CFG,   COMMON_CFG_PASI_RX_CH2_CFG,     0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_OUT1X_CFG0,        COMMON_CFG_OUT1X_CFG0,          0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_OUT1X_CFG1,        COMMON_CFG_OUT1X_CFG1,          0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_OUT1X_CFG2,        COMMON_CFG_OUT1X_CFG2,          0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_DAC_CH1A_CFG0,     COMMON_CFG_DAC_CH1A_CFG0,       0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_OUT2X_CFG0,        COMMON_CFG_OUT2X_CFG0,          0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_OUT2X_CFG1,        COMMON_CFG_OUT2X_CFG1,          0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_OUT2X_CFG2,        COMMON_CFG_OUT2X_CFG2,          0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_DAC_CH2A_CFG0,     COMMON_CFG_DAC_CH2A_CFG0,       0),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_DSP_CFG1,          COMMON_CFG_DSP_CFG1,            0),
+    TAD5212_STEP_LAST,
+};
+
+/* Stereo topology (2x 2-way speakers), crossover filters loaded from the sample rate cache */
+const static tad5212_init_step_t STEREO_CFG_INIT_SEQUENCE[] =
+{
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_CH_EN,             COMMON_CFG_CH_EN,               0),
+    TAD5212_STEP_LAST,
+};
+
+/* Stereo topology crossover: 150 Hz high-pass and 16 kHz low-pass on both DACs */
+const static tad5212_crossover_t STEREO_CFG_CROSSOVER[] =
+{
+    TAD5212_CROSSOVER(TAD5212_DAC1_BIQUAD_FILTER_1, TAD5212_BIQUAD_TYPE_HIGHPASS,   150),
+    TAD5212_CROSSOVER(TAD5212_DAC1_BIQUAD_FILTER_2, TAD5212_BIQUAD_TYPE_LOWPASS,    16000),
+    TAD5212_CROSSOVER(TAD5212_DAC2_BIQUAD_FILTER_1, TAD5212_BIQUAD_TYPE_HIGHPASS,   150),
+    TAD5212_CROSSOVER(TAD5212_DAC2_BIQUAD_FILTER_2, TAD5212_BIQUAD_TYPE_LOWPASS,    16000),
+    TAD5212_CROSSOVER_LAST,
+};
+
+/* Power up, once the topology is loaded */
+const static tad5212_init_step_t COMMON_CFG_POWER_UP_SEQUENCE[] =
+{
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_PWR_CFG,           COMMON_CFG_PWR_CFG,             0),
+    TAD5212_STEP_LAST,
+};
+
 #endif /* __TAD5212_COMMON_CONFIG_H__ */
\ No newline at end of file
@@ -39,4 +39,24 @@ const static tad5212_REG_CH_EN_t SUBWOOFER_CFG_CH_EN =
     .in_ch1_en                  = 0x0,  /* Disable input channel 1 */
 };
 
+/*** Initialization sequence *********************************************************/
+
+/* Subwoofer topology: (L + R) / 2 on DAC 2, crossover filters loaded from the sample rate cache */
+const static tad5212_init_step_t SUBWOOFER_CFG_INIT_SEQUENCE[] =
+{
+    TAD5212_STEP_REG(TAD5212_PAGE_1, REG_MIXER_CFG0,    SUBWOOFER_CFG_MIXER_CFG0,   0),
+    TAD5212_STEP_MIX(TAD5212_ASI_DIN_MIX_ASI_CH1, TAD5212_MIXER_RDAC_DIV_2),
+    TAD5212_STEP_MIX(TAD5212_ASI_DIN_MIX_ASI_CH2, TAD5212_MIXER_RDAC_DIV_2),
+    TAD5212_STEP_REG(TAD5212_PAGE_0, REG_CH_EN,         SUBWOOFER_CFG_CH_EN,        0),
+    TAD5212_STEP_LAST,
+};
+
+/* Subwoofer topology crossover: 4th order 150 Hz low-pass on DAC 2 */
+const static tad5212_crossover_t SUBWOOFER_CFG_CROSSOVER[] =
+{
+    TAD5212_CROSSOVER(TAD5212_DAC2_BIQUAD_FILTER_1, TAD5212_BIQUAD_TYPE_LOWPASS,    150),
+    TAD5212_CROSSOVER(TAD5212_DAC2_BIQUAD_FILTER_2, TAD5212_BIQUAD_TYPE_LOWPASS,    150),
+    TAD5212_CROSSOVER_LAST,
+};
+
 #endif /* __TAD5212_SUBWOOFER_CONFIG_H__ */
\ No newline at end of file
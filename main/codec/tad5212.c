@@ -8,6 +8,11 @@
 
 /*** Includes ***********************************************************************/
 
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
 #include "tad5212.h"
 #include "sys/lock.h"
 
@@ -18,7 +23,14 @@
 
 /* I2C configuration */
 #define TAD5212_I2C_READ_TIMEOUT_MS     100         /* 100ms read timeout */
-#define TAD5212_I2C_WRITE_TIMEOUT_MS    -1          /* Infinite write timeout */
+#define TAD5212_I2C_WRITE_TIMEOUT_MS    100         /* 100ms write timeout */
+#define TAD5212_I2C_BURST_MAX           32          /* Registers written by one burst */
+#define TAD5212_I2C_ERROR_LIMIT         3           /* Consecutive errors before lowering the speed */
+
+/* Link check: patterns written then read back, then the value the register held before */
+#define TAD5212_I2C_PROBE_REG           REG_PASI_RX_CH8_CFG
+#define TAD5212_I2C_PROBE_RESET         0x00        /* Value after a reset */
+#define TAD5212_I2C_PROBE_PATTERNS      { 0x55, 0xAA, 0x0F, 0xF0 }
 
 /*** Enumerations ***************************************************************************/
 
@@ -28,6 +40,17 @@
 
 /*** Static variables ***********************************************************************/
 
+/* Sample rates the crossover filters are cached for */
+static const uint32_t sample_rates[TAD5212_SAMPLE_RATE_COUNT] = TAD5212_SAMPLE_RATES;
+
+/* Biquad filter of each coefficient slot */
+static const tad5212_biquad_filter_t biquad_slot_filters[TAD5212_BIQUAD_SLOTS] =
+{
+    TAD5212_DAC1_BIQUAD_FILTER_1, TAD5212_DAC2_BIQUAD_FILTER_1,
+    TAD5212_DAC1_BIQUAD_FILTER_2, TAD5212_DAC2_BIQUAD_FILTER_2,
+    TAD5212_DAC1_BIQUAD_FILTER_3, TAD5212_DAC2_BIQUAD_FILTER_3,
+};
+
 /*** Prototypes *****************************************************************************/
 
 /**
@@ -41,13 +64,23 @@ static esp_err_t write_1b_register(tad5212_handle_t* device, uint8_t reg, uint8_
 
 
 /**
- * \brief Write a 4 byte value to a register of the TAD5212 device.
+ * \brief Write consecutive registers of the TAD5212 device in a single transaction,
+ *        the device increments the register address after each byte.
  * \param device Pointer to TAD5212 handle
- * \param reg Register address to write.
- * \param value Value to write to the register.
+ * \param reg Address of the first register to write.
+ * \param data Values to write, from the first register on.
+ * \param len Number of registers to write, at most TAD5212_I2C_BURST_MAX.
  * \return ESP_OK on success, error code otherwise.
  */
-static esp_err_t write_4b_register(tad5212_handle_t* device, uint8_t reg, uint32_t value);
+static esp_err_t write_burst_register(tad5212_handle_t* device, uint8_t reg, const uint8_t* data, size_t len);
+
+
+/**
+ * \brief Store a 4 byte register value, MSB first, in a burst buffer.
+ * \param out Pointer to the 4 bytes of the buffer.
+ * \param value Value of the register.
+ */
+inline static void put_4b_value(uint8_t* out, uint32_t value);
 
 
 /** 
@@ -68,6 +101,50 @@ static esp_err_t read_1b_register(tad5212_handle_t* device, uint8_t reg, uint8_t
 inline static esp_err_t select_page(tad5212_handle_t* device, uint8_t page);
 
 
+/** 
+ *  \brief Read a 1 byte register, from the shadow when it holds the register value.
+ *  \param device Pointer to TAD5212 handle
+ *  \param reg Register address to read.
+ *  \param value Pointer to store the value of the register.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t read_1b_register_cached(tad5212_handle_t* device, uint8_t reg, uint8_t *value);
+
+
+/**
+ *  \brief Get a register value from the shadow of the current page.
+ *  \param device Pointer to TAD5212 handle
+ *  \param reg Register address.
+ *  \param value Pointer to store the value of the register.
+ *  \return true if the shadow holds the register value, false otherwise.
+ */
+static bool shadow_get(tad5212_handle_t* device, uint8_t reg, uint8_t *value);
+
+
+/**
+ *  \brief Record a register value in the shadow of the current page.
+ *  \param device Pointer to TAD5212 handle
+ *  \param reg Register address.
+ *  \param value Value of the register.
+ */
+static void shadow_set(tad5212_handle_t* device, uint8_t reg, uint8_t value);
+
+
+/**
+ *  \brief Forget a register value of the current page.
+ *  \param device Pointer to TAD5212 handle
+ *  \param reg Register address.
+ */
+static void shadow_clear(tad5212_handle_t* device, uint8_t reg);
+
+
+/**
+ *  \brief Forget all the register values and the current page.
+ *  \param device Pointer to TAD5212 handle
+ */
+static void shadow_invalidate(tad5212_handle_t* device);
+
+
 /** \brief Check if a command requires a delay after execution.
  *
  *  \param reg Register address of the command.
@@ -76,6 +153,14 @@ inline static esp_err_t select_page(tad5212_handle_t* device, uint8_t page);
 inline static bool cmd_requires_wait(uint8_t reg);
 
 
+/** \brief Check if a register is changed by the device itself and must not be cached.
+ *
+ *  \param reg Register address of page 0.
+ *  \return true if the register is volatile, false otherwise.
+ */
+inline static bool reg_is_volatile(uint8_t reg);
+
+
 /** \brief Check if a page requires a 4-byte transaction.
  *
  *  \param page Page number to check.
@@ -84,6 +169,113 @@ inline static bool cmd_requires_wait(uint8_t reg);
 inline static bool page_requires_4bytes_transaction(uint8_t page);
 
 
+/**
+ *  \brief Run an initialization sequence, contiguous registers of a page are written in one burst.
+ *  \param device Pointer to TAD5212 handle
+ *  \param steps Sequence, ended by a TAD5212_STEP_END step.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t run_init_sequence(tad5212_handle_t* device, const tad5212_init_step_t* steps);
+
+
+/**
+ *  \brief Attach the device to the bus at a given I2C speed. The device stays attached at its
+ *         previous speed if the new attachment fails.
+ *  \param device Pointer to TAD5212 handle
+ *  \param scl_speed_hz I2C speed.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t set_i2c_speed(tad5212_handle_t* device, uint32_t scl_speed_hz);
+
+
+/**
+ *  \brief Get the next I2C speed below a given one.
+ *  \param scl_speed_hz I2C speed.
+ *  \return Lower I2C speed, or 0 at standard mode.
+ */
+inline static uint32_t lower_i2c_speed(uint32_t scl_speed_hz);
+
+
+/**
+ *  \brief Track the result of an I2C transaction, a fallback is flagged after repeated errors.
+ *         Called with the device lock held.
+ *  \param device Pointer to TAD5212 handle
+ *  \param ret Result of the transaction.
+ */
+static void i2c_link_update(tad5212_handle_t* device, esp_err_t ret);
+
+
+/**
+ *  \brief Lower the I2C speed if i2c_link_update flagged a fallback, and check the link at the new
+ *         speed. Called after a transaction, with the device lock released.
+ *  \param device Pointer to TAD5212 handle
+ */
+static void i2c_link_fallback(tad5212_handle_t* device);
+
+
+/**
+ *  \brief Check the link at the current I2C speed by writing and reading back patterns, then the
+ *         value the probe register must keep.
+ *  \param device Pointer to TAD5212 handle
+ *  \param restore Value left in the probe register.
+ *  \return ESP_OK if every pattern was read back, error code otherwise.
+ */
+static esp_err_t check_i2c_link(tad5212_handle_t* device, uint8_t restore);
+
+
+/**
+ *  \brief Select the highest reliable I2C speed, starting from a given one.
+ *  \param device Pointer to TAD5212 handle
+ *  \param scl_speed_hz Highest I2C speed to try.
+ *  \return ESP_OK on success, error code if the link fails at standard mode.
+ */
+static esp_err_t negotiate_i2c_speed(tad5212_handle_t* device, uint32_t scl_speed_hz);
+
+
+/**
+ *  \brief Get the crossover cache entry of a sample rate.
+ *  \param sample_rate Sample rate in Hz.
+ *  \return Index in the cache, or -1 if the rate is not supported.
+ */
+static int sample_rate_index(uint32_t sample_rate);
+
+
+/**
+ *  \brief Design the crossover filters of a topology for every supported sample rate.
+ *  \param device Pointer to TAD5212 handle
+ *  \param crossover Crossover filters, ended by a filter 0.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t build_crossover_cache(tad5212_handle_t* device, const tad5212_crossover_t* crossover);
+
+
+/**
+ *  \brief Load the cached crossover filters of a sample rate.
+ *  \param device Pointer to TAD5212 handle
+ *  \param index Cache entry of the sample rate.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t load_crossover(tad5212_handle_t* device, int index);
+
+
+/**
+ *  \brief Get the coefficient slot of a biquad filter.
+ *  \param filter Biquad filter.
+ *  \return Slot index, or -1 if the filter has no programmable coefficients.
+ */
+static int biquad_slot(tad5212_biquad_filter_t filter);
+
+
+/**
+ *  \brief Write the coefficients of a biquad filter in one burst.
+ *  \param device Pointer to TAD5212 handle
+ *  \param filter Biquad filter.
+ *  \param coeffs Coefficients.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t write_biquad(tad5212_handle_t* device, tad5212_biquad_filter_t filter, const tad5212_biquad_coeffs_t* coeffs);
+
+
 /** \brief Set biquad filter coefficients
  *  \param channel Channel to set the biquad filter coefficients
  *  \param filter Biquad filter to set the coefficients
@@ -123,10 +315,32 @@ static esp_err_t write_1b_register(tad5212_handle_t* device, uint8_t reg, uint8_
 
     /* Write operation*/
     const uint8_t out[] = { reg, value };
+    uint8_t cached;
 
     _lock_acquire(&device->lock);
+
+    /* Register already holds the value, skip the transaction */
+    if (shadow_get(device, reg, &cached) && cached == value)
+    {
+        _lock_release(&device->lock);
+        return ESP_OK;
+    }
+
     esp_err_t ret = i2c_master_transmit(device->dev, out, sizeof(out), TAD5212_I2C_WRITE_TIMEOUT_MS);
+    i2c_link_update(device, ret);
+
+    if (ret == ESP_OK)
+    {
+        shadow_set(device, reg, value);
+    }
+    else
+    {
+        /* Write may have been applied or not */
+        shadow_clear(device, reg);
+    }
+
     _lock_release(&device->lock);
+    i2c_link_fallback(device);
 
     if (ret != ESP_OK)
     {
@@ -139,13 +353,15 @@ static esp_err_t write_1b_register(tad5212_handle_t* device, uint8_t reg, uint8_
 
 
 /**
- * \brief Write a 4 byte value to a register of the TAD5212 device.
+ * \brief Write consecutive registers of the TAD5212 device in a single transaction,
+ *        the device increments the register address after each byte.
  * \param device Pointer to TAD5212 handle
- * \param reg Register address to write.
- * \param value Value to write to the register.
+ * \param reg Address of the first register to write.
+ * \param data Values to write, from the first register on.
+ * \param len Number of registers to write, at most TAD5212_I2C_BURST_MAX.
  * \return ESP_OK on success, error code otherwise.
  */
-static esp_err_t write_4b_register(tad5212_handle_t* device, uint8_t reg, uint32_t value)
+static esp_err_t write_burst_register(tad5212_handle_t* device, uint8_t reg, const uint8_t* data, size_t len)
 {
     /* Check I2C device handler pointer address */
     if (device == NULL || device->bus == NULL || device->dev == NULL)
@@ -154,20 +370,37 @@ static esp_err_t write_4b_register(tad5212_handle_t* device, uint8_t reg, uint32
         return ESP_ERR_INVALID_ARG;
     }
 
-    /* Build write sequence */
-    const uint8_t out[] = 
-    { 
-        reg, 
-        (uint8_t)(value >> 24), 
-        (uint8_t)(value >> 16), 
-        (uint8_t)(value >> 8), 
-        (uint8_t)(value) 
-    };
+    /* Check data length */
+    if (data == NULL || len == 0 || len > TAD5212_I2C_BURST_MAX)
+    {
+        ESP_LOGE(TAD5212_TAG, "Invalid burst of %u bytes", (unsigned)len);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Build write sequence: start address followed by the values */
+    uint8_t out[1 + TAD5212_I2C_BURST_MAX];
+
+    out[0] = reg;
+    memcpy(&out[1], data, len);
 
     /* Write operation*/
     _lock_acquire(&device->lock);
-    esp_err_t ret = i2c_master_transmit(device->dev, out, sizeof(out), TAD5212_I2C_WRITE_TIMEOUT_MS);
+    esp_err_t ret = i2c_master_transmit(device->dev, out, 1 + len, TAD5212_I2C_WRITE_TIMEOUT_MS);
+    i2c_link_update(device, ret);
+
+    for (size_t i = 0; i < len; i++)
+    {
+        if (ret == ESP_OK)
+        {
+            shadow_set(device, reg + i, data[i]);
+        }
+        else
+        {
+            shadow_clear(device, reg + i);
+        }
+    }
     _lock_release(&device->lock);
+    i2c_link_fallback(device);
 
     if (ret != ESP_OK)
     {
@@ -179,6 +412,20 @@ static esp_err_t write_4b_register(tad5212_handle_t* device, uint8_t reg, uint32
 }
 
 
+/**
+ * \brief Store a 4 byte register value, MSB first, in a burst buffer.
+ * \param out Pointer to the 4 bytes of the buffer.
+ * \param value Value of the register.
+ */
+inline static void put_4b_value(uint8_t* out, uint32_t value)
+{
+    out[0] = (uint8_t)(value >> 24);
+    out[1] = (uint8_t)(value >> 16);
+    out[2] = (uint8_t)(value >> 8);
+    out[3] = (uint8_t)(value);
+}
+
+
 /** \brief Read a 1 byte register from the TAD5212 device.
  *  \param device Pointer to TAD5212 handle
  *  \param reg Register address to read.
@@ -206,7 +453,9 @@ static esp_err_t read_1b_register(tad5212_handle_t* device, uint8_t reg, uint8_t
 
     _lock_acquire(&device->lock);
     esp_err_t ret = i2c_master_transmit_receive(device->dev, out, sizeof(out), value, 1, TAD5212_I2C_READ_TIMEOUT_MS);
+    i2c_link_update(device, ret);
     _lock_release(&device->lock);
+    i2c_link_fallback(device);
 
     if (ret != ESP_OK)
     {
@@ -219,387 +468,826 @@ static esp_err_t read_1b_register(tad5212_handle_t* device, uint8_t reg, uint8_t
 
 
 /** 
- *  \brief Select the register page.
+ *  \brief Read a 1 byte register, from the shadow when it holds the register value.
  *  \param device Pointer to TAD5212 handle
- *  \param page Page number to select.
+ *  \param reg Register address to read.
+ *  \param value Pointer to store the value of the register.
+ *  \return ESP_OK on success, error code otherwise.
  */
-inline static esp_err_t select_page(tad5212_handle_t* device, uint8_t page)
+static esp_err_t read_1b_register_cached(tad5212_handle_t* device, uint8_t reg, uint8_t *value)
 {
-    return write_1b_register(device, REG_PAGE_CFG, page);
-}
+    bool cached;
 
+    /* Check I2C device handler pointer address */
+    if (device == NULL || value == NULL)
+    {
+        ESP_LOGE(TAD5212_TAG, "Invalid argument: device or value pointer is NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
 
-/** \brief Check if a command requires a delay after execution.
- *
- *  \param reg Register address of the command.
- *  \return true if the command requires a delay, false otherwise.
- */
-inline static bool cmd_requires_wait(uint8_t reg)
-{
-    return (REG_SW_RESET == reg || REG_DEV_MISC_CFG == reg);
-}
+    _lock_acquire(&device->lock);
+    cached = shadow_get(device, reg, value);
+    _lock_release(&device->lock);
 
+    if (cached)
+    {
+        return ESP_OK;
+    }
 
-/** \brief Check if a page requires a 4-byte transaction.
- *
- *  \param page Page number to check.
- *  \return true if the page requires a 4-byte transaction, false otherwise.
- */
-inline static bool page_requires_4bytes_transaction(uint8_t page)
-{
-    return (page >= TAD5212_PAGE_15);
-}
+    /* Not known yet, read it once from the device */
+    esp_err_t ret = read_1b_register(device, reg, value);
 
-/*** Public functions ***********************************************************************/
+    if (ret == ESP_OK)
+    {
+        _lock_acquire(&device->lock);
+        shadow_set(device, reg, *value);
+        _lock_release(&device->lock);
+    }
+
+    return ret;
+}
 
 
 /**
- *  \brief Initialize the TAD5212 codec
- *  \param device TAD5212 device
- *  \param i2c_bus_handle I2C bus handler
- *  \param i2c_addr I2C address of the TAD5212 device
- *  \return ESP_OK on success, error code otherwise.
+ *  \brief Get a register value from the shadow of the current page.
+ *  \param device Pointer to TAD5212 handle
+ *  \param reg Register address.
+ *  \param value Pointer to store the value of the register.
+ *  \return true if the shadow holds the register value, false otherwise.
  */
-esp_err_t tad5212_init(tad5212_handle_t* device, i2c_master_bus_handle_t i2c_bus_handle, tad5212_i2c_addr_t i2c_addr, tad5212_config_select_t cfg)
+static bool shadow_get(tad5212_handle_t* device, uint8_t reg, uint8_t *value)
 {
-    esp_err_t status;
-    
-    if (device == NULL)
-    {
-        ESP_LOGE(TAD5212_TAG, "Device handler NULL");
-        return ESP_ERR_INVALID_STATE;
-    }
+    uint8_t page = device->page;
 
-    /* Check device initialization state */
-    if (device->initialized == true) 
+    /* Page register is the same on every page */
+    if (reg == REG_PAGE_CFG)
     {
-        ESP_LOGE(TAD5212_TAG, "Device already initialized");
-        return ESP_ERR_INVALID_STATE;
+        *value = page;
+        return (page != TAD5212_PAGE_UNKNOWN);
     }
 
-    _lock_init(&device->lock);
-
-    /* Initialize I2C interface */
-    if (i2c_bus_handle == NULL)
-    {
-        ESP_LOGE(TAD5212_TAG, "I2C bus handle NULL");
-        return ESP_ERR_INVALID_ARG;
-    }
-    else
+    if (page >= TAD5212_SHADOW_PAGES || reg >= TAD5212_SHADOW_REGS || (page == TAD5212_PAGE_0 && reg_is_volatile(reg)))
     {
-        device->bus = i2c_bus_handle;
+        return false;
     }
 
-    if (i2c_addr != TAD5212_I2C_ADDR_SHORT && 
-        i2c_addr != TAD5212_I2C_ADDR_PD_4_7K &&
-        i2c_addr != TAD5212_I2C_ADDR_PU_4_7K && 
-        i2c_addr != TAD5212_I2C_ADDR_PU_22K)
+    if ((device->shadow_valid[page][reg / 32] & (1UL << (reg % 32))) == 0)
     {
-        ESP_LOGE(TAD5212_TAG, "TAD5212 I2C address unknown");
-        return ESP_ERR_INVALID_ARG;
-    }
-    else
-    {
-        device->addr = i2c_addr;
+        return false;
     }
 
-    /* Create device only once */
-    i2c_device_config_t device_config = 
-    {
-        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-        .device_address = i2c_addr,
-        .scl_speed_hz = 100000,
-    };
+    *value = device->shadow[page][reg];
 
-    status = i2c_master_bus_add_device(device->bus, &device_config, &device->dev);
+    return true;
+}
 
-    if (status != ESP_OK)
+
+/**
+ *  \brief Record a register value in the shadow of the current page.
+ *  \param device Pointer to TAD5212 handle
+ *  \param reg Register address.
+ *  \param value Value of the register.
+ */
+static void shadow_set(tad5212_handle_t* device, uint8_t reg, uint8_t value)
+{
+    uint8_t page = device->page;
+
+    if (reg == REG_PAGE_CFG)
     {
-        ESP_LOGE(TAD5212_TAG, "I2C device init failed: %s", esp_err_to_name(status));
-        return status;
+        device->page = value;
+        return;
     }
 
-    /* Selects page 0 for registers adressing */
-    status = select_page(device, TAD5212_PAGE_0);
-    if (status != ESP_OK)
+    /* Software reset restores the default values and page 0 */
+    if (page == TAD5212_PAGE_0 && reg == REG_SW_RESET)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to select register page 0: %s", esp_err_to_name(status));
-        return status;
+        shadow_invalidate(device);
+        device->page = TAD5212_PAGE_0;
+        return;
     }
 
-    /* Performs software reset */
-    status = write_1b_register(device, REG_SW_RESET, COMMON_CFG_SW_RESET.data);
-    if (status != ESP_OK)
+    if (page >= TAD5212_SHADOW_PAGES || reg >= TAD5212_SHADOW_REGS || (page == TAD5212_PAGE_0 && reg_is_volatile(reg)))
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write SW_RESET register: %s", esp_err_to_name(status));
-        return status;
+        return;
     }
 
-    /* Delay of 10ms after reset */
-    esp_rom_delay_us(10000);  
+    device->shadow[page][reg] = value;
+    device->shadow_valid[page][reg / 32] |= (1UL << (reg % 32));
+}
 
-    /* Selects page 0 for registers adressing */
-    status = select_page(device, TAD5212_PAGE_0);
-    if (status != ESP_OK)
-    {
-        ESP_LOGE(TAD5212_TAG, "Failed to select register page 0: %s", esp_err_to_name(status));
-        return status;
-    }
-    
-    /* Configuration of device miscellaneous settings */
-    status = write_1b_register(device, REG_DEV_MISC_CFG, COMMON_CFG_DEV_MISC_CFG_P0.data);
-    if (status != ESP_OK)
-    {
-        ESP_LOGE(TAD5212_TAG, "Failed to write DEV_MISC_CFG register: %s", esp_err_to_name(status));
-        return status;
-    }
 
-    /* Delay of 10 ms for AREG and VREF to stabilize */
-    esp_rom_delay_us(10000);  
+/**
+ *  \brief Forget a register value of the current page.
+ *  \param device Pointer to TAD5212 handle
+ *  \param reg Register address.
+ */
+static void shadow_clear(tad5212_handle_t* device, uint8_t reg)
+{
+    uint8_t page = device->page;
 
-    /* Configuration of the device DAC de-pop */
-    status = write_1b_register(device, REG_DAC_CFG_A0, COMMON_CFG_DAC_CFG_A0.data);
-    if (status != ESP_OK)
+    if (reg == REG_PAGE_CFG || (page == TAD5212_PAGE_0 && reg == REG_SW_RESET))
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write DAC_CFG_A0 register: %s", esp_err_to_name(status));
-        return status;
+        shadow_invalidate(device);
+        return;
     }
 
-    /* Configuration of the device DAC de-pop 2 */
-    status = write_1b_register(device, REG_MISC_CFG0, COMMON_CFG_MISC_CFG0.data);
-    if (status != ESP_OK)
+    if (page >= TAD5212_SHADOW_PAGES || reg >= TAD5212_SHADOW_REGS)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write MISC_CFGG0 register: %s", esp_err_to_name(status));
-        return status;
+        return;
     }
 
-    /* Configuration of DOUT output */
-    status = write_1b_register(device, REG_INTF_CFG1, COMMON_CFG_INTF_CFG1.data);
-    if (status != ESP_OK)
-    {
-        ESP_LOGE(TAD5212_TAG, "Failed to write INTF_CFG1 register: %s", esp_err_to_name(status));
-        return status;
-    }
+    device->shadow_valid[page][reg / 32] &= ~(1UL << (reg % 32));
+}
 
-    /* Configuration of data inputs MUX ASI */
-    status = write_1b_register(device, REG_ASI_CFG1, COMMON_CFG_ASI_CFG1.data);
-    if (status != ESP_OK)
+
+/**
+ *  \brief Forget all the register values and the current page.
+ *  \param device Pointer to TAD5212 handle
+ */
+static void shadow_invalidate(tad5212_handle_t* device)
+{
+    memset(device->shadow_valid, 0, sizeof(device->shadow_valid));
+    device->page = TAD5212_PAGE_UNKNOWN;
+}
+
+
+/** 
+ *  \brief Select the register page, skipped when the page is already selected.
+ *  \param device Pointer to TAD5212 handle
+ *  \param page Page number to select.
+ */
+inline static esp_err_t select_page(tad5212_handle_t* device, uint8_t page)
+{
+    return write_1b_register(device, REG_PAGE_CFG, page);
+}
+
+
+/** \brief Check if a command requires a delay after execution.
+ *
+ *  \param reg Register address of the command.
+ *  \return true if the command requires a delay, false otherwise.
+ */
+inline static bool cmd_requires_wait(uint8_t reg)
+{
+    return (REG_SW_RESET == reg || REG_DEV_MISC_CFG == reg);
+}
+
+
+/** \brief Check if a register is changed by the device itself and must not be cached.
+ *
+ *  \param reg Register address of page 0.
+ *  \return true if the register is volatile, false otherwise.
+ */
+inline static bool reg_is_volatile(uint8_t reg)
+{
+    return (REG_AVDD_IOVDD_STS == reg || 
+            (REG_CLK_ERR_STS0 <= reg && reg <= REG_CLK_DET_STS3) ||
+            REG_DEV_STS0 == reg || REG_DEV_STS1 == reg || 
+            REG_I2C_CKSUM == reg);
+}
+
+
+/** \brief Check if a page requires a 4-byte transaction.
+ *
+ *  \param page Page number to check.
+ *  \return true if the page requires a 4-byte transaction, false otherwise.
+ */
+inline static bool page_requires_4bytes_transaction(uint8_t page)
+{
+    return (page >= TAD5212_PAGE_15);
+}
+
+/**
+ *  \brief Run an initialization sequence, contiguous registers of a page are written in one burst.
+ *  \param device Pointer to TAD5212 handle
+ *  \param steps Sequence, ended by a TAD5212_STEP_END step.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t run_init_sequence(tad5212_handle_t* device, const tad5212_init_step_t* steps)
+{
+    esp_err_t status = ESP_OK;
+    uint8_t burst[TAD5212_I2C_BURST_MAX];
+    const tad5212_init_step_t* step;
+    uint8_t page = 0;
+    uint8_t reg = 0;
+    size_t len = 0;
+
+    for (step = steps; step->type != TAD5212_STEP_END; step++)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write ASI_CFG1 register: %s", esp_err_to_name(status));
-        return status;
+        if (step->type == TAD5212_STEP_REGISTER)
+        {
+            /* Extend the pending burst when the registers follow each other */
+            if (len == 0 || step->page != page || step->reg != reg + len || len + step->len > sizeof(burst))
+            {
+                page = step->page;
+                reg = step->reg;
+                len = 0;
+            }
+
+            memcpy(&burst[len], step->payload, step->len);
+            len += step->len;
+
+            /* Burst is sent once the next step cannot join it */
+            const tad5212_init_step_t* next = step + 1;
+
+            if (step->delay_ms == 0 && next->type == TAD5212_STEP_REGISTER && next->page == page && 
+                next->reg == reg + len && len + next->len <= sizeof(burst))
+            {
+                continue;
+            }
+
+            status = select_page(device, page);
+            if (status == ESP_OK)
+            {
+                status = (len == 1) ? write_1b_register(device, reg, burst[0]) 
+                                    : write_burst_register(device, reg, burst, len);
+            }
+            len = 0;
+        }
+        else if (step->type == TAD5212_STEP_BIQUAD)
+        {
+            status = tad5212_set_biquad_coeff(device, (tad5212_biquad_filter_t)step->reg, *(const tad5212_biquad_coeffs_t*)step->payload);
+        }
+        else if (step->type == TAD5212_STEP_MIXER)
+        {
+            status = tad5212_set_mixer_coeff(device, (tad5212_mixer_t)step->reg, *(const tad5212_mixer_coeffs_t*)step->payload);
+        }
+        else
+        {
+            status = ESP_ERR_INVALID_ARG;
+        }
+
+        if (status != ESP_OK)
+        {
+            ESP_LOGE(TAD5212_TAG, "Init step %d failed (page %d, register 0x%02x): %s", 
+                     (int)(step - steps), step->page, step->reg, esp_err_to_name(status));
+            return status;
+        }
+
+        /* Settle time, the scheduler keeps running */
+        if (step->delay_ms > 0)
+        {
+            vTaskDelay(pdMS_TO_TICKS(step->delay_ms) + 1);
+        }
     }
 
-    /* Configuration of Primary Audio Serial Interface */
-    status = write_1b_register(device, REG_PASI_CFG0, COMMON_CFG_PASI_CFG0.data);
-    if (status != ESP_OK)
+    return ESP_OK;
+}
+
+/**
+ *  \brief Attach the device to the bus at a given I2C speed. The device stays attached at its
+ *         previous speed if the new attachment fails.
+ *  \param device Pointer to TAD5212 handle
+ *  \param scl_speed_hz I2C speed.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t set_i2c_speed(tad5212_handle_t* device, uint32_t scl_speed_hz)
+{
+    esp_err_t status;
+
+    i2c_device_config_t device_config = 
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write PASI_CFG0 register: %s", esp_err_to_name(status));
-        return status;
-    }
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = device->addr,
+        .scl_speed_hz = scl_speed_hz,
+    };
 
-    /* Configuration of Primary Audio Serial Interface RX Channel 1 */
-    status = write_1b_register(device, REG_PASI_RX_CH1_CFG, COMMON_CFG_PASI_RX_CH1_CFG.data);
+    i2c_master_dev_handle_t dev = NULL;
+    i2c_master_dev_handle_t old_dev;
+
+    /* Speed of an I2C device is fixed when it is added to the bus: the new handle is added first,
+     * the old one is only removed once it is replaced */
+    status = i2c_master_bus_add_device(device->bus, &device_config, &dev);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write PASI_RX_CH1_CFG register: %s", esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "I2C device init failed: %s", esp_err_to_name(status));
         return status;
     }
 
-    /* Configuration of Primary Audio Serial Interface RX Channel 2 */
-    status = write_1b_register(device, REG_PASI_RX_CH2_CFG, COMMON_CFG_PASI_RX_CH2_CFG.data);
-    if (status != ESP_OK)
+    _lock_acquire(&device->lock);
+    old_dev = device->dev;
+    device->dev = dev;
+    device->scl_speed_hz = scl_speed_hz;
+    device->i2c_errors = 0;
+    _lock_release(&device->lock);
+
+    if (old_dev != NULL)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write PASI_RX_CH2_CFG register: %s", esp_err_to_name(status));
-        return status;
+        status = i2c_master_bus_rm_device(old_dev);
+        if (status != ESP_OK)
+        {
+            ESP_LOGW(TAD5212_TAG, "I2C device removal failed: %s", esp_err_to_name(status));
+        }
     }
 
-    /* Configuration of DAC Channel 1 */
-    status = write_1b_register(device, REG_OUT1X_CFG0, COMMON_CFG_OUT1X_CFG0.data);
-    if (status != ESP_OK)
+    return ESP_OK;
+}
+
+
+/**
+ *  \brief Get the next I2C speed below a given one.
+ *  \param scl_speed_hz I2C speed.
+ *  \return Lower I2C speed, or 0 at standard mode.
+ */
+inline static uint32_t lower_i2c_speed(uint32_t scl_speed_hz)
+{
+    if (scl_speed_hz > TAD5212_I2C_SPEED_FAST)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write OUT1X_CFG0 register: %s", esp_err_to_name(status));
-        return status;
+        return TAD5212_I2C_SPEED_FAST;
     }
 
-    /* Configuration of DAC Channel 1 OUT1P as line out driver */
-    status = write_1b_register(device, REG_OUT1X_CFG1, COMMON_CFG_OUT1X_CFG1.data);
-    if (status != ESP_OK)
+    if (scl_speed_hz > TAD5212_I2C_SPEED_STANDARD)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write OUT1X_CFG1 register: %s", esp_err_to_name(status));
-        return status;
+        return TAD5212_I2C_SPEED_STANDARD;
     }
 
-    /* Configuration of DAC Channel 1 OUT1M as line out driver */
-    status = write_1b_register(device, REG_OUT1X_CFG2, COMMON_CFG_OUT1X_CFG2.data);
-    if (status != ESP_OK)
+    return 0;
+}
+
+
+/**
+ *  \brief Track the result of an I2C transaction, a fallback is flagged after repeated errors.
+ *         Called with the device lock held.
+ *  \param device Pointer to TAD5212 handle
+ *  \param ret Result of the transaction.
+ */
+static void i2c_link_update(tad5212_handle_t* device, esp_err_t ret)
+{
+    if (ret == ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write OUT1X_CFG2 register: %s", esp_err_to_name(status));
-        return status;
+        device->i2c_errors = 0;
+        return;
     }
 
-    /* DAC 1 Volume configuration set to mute */
-    status = write_1b_register(device, REG_DAC_CH1A_CFG0, COMMON_CFG_DAC_CH1A_CFG0.data);
-    if (status != ESP_OK)
+    /* During init and fallbacks the speed is chosen by negotiate_i2c_speed */
+    if (device->initialized == false || device->i2c_negotiating ||
+        ++device->i2c_errors < TAD5212_I2C_ERROR_LIMIT)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write DAC_CH1A_CFG0 register: %s", esp_err_to_name(status));
-        return status;
+        return;
     }
 
-    /* Configuration of DAC Channel 2 */
-    status = write_1b_register(device, REG_OUT2X_CFG0, COMMON_CFG_OUT2X_CFG0.data);
-    if (status != ESP_OK)
+    /* The bus is never touched in the middle of a transaction */
+    device->i2c_errors = 0;
+    device->i2c_fallback = (lower_i2c_speed(device->scl_speed_hz) != 0);
+}
+
+
+/**
+ *  \brief Lower the I2C speed if i2c_link_update flagged a fallback, and check the link at the new
+ *         speed. Called after a transaction, with the device lock released.
+ *  \param device Pointer to TAD5212 handle
+ */
+static void i2c_link_fallback(tad5212_handle_t* device)
+{
+    uint32_t speed;
+    uint8_t page;
+
+    _lock_acquire(&device->lock);
+    speed = device->i2c_fallback ? lower_i2c_speed(device->scl_speed_hz) : 0;
+    device->i2c_fallback = false;
+    page = device->page;
+    _lock_release(&device->lock);
+
+    if (speed == 0)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write OUT2X_CFG0 register: %s", esp_err_to_name(status));
-        return status;
+        return;
     }
 
-    /* Configuration of DAC Channel 2 OUT2P as line out driver */
-    status = write_1b_register(device, REG_OUT2X_CFG1, COMMON_CFG_OUT2X_CFG1.data);
-    if (status != ESP_OK)
+    ESP_LOGW(TAD5212_TAG, "0x%02x: %d I2C errors, falling back to %lu Hz", device->addr, TAD5212_I2C_ERROR_LIMIT, (unsigned long)speed);
+
+    if (negotiate_i2c_speed(device, speed) != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write OUT2X_CFG1 register: %s", esp_err_to_name(status));
-        return status;
+        ESP_LOGE(TAD5212_TAG, "0x%02x: I2C link unreliable at every speed", device->addr);
+        return;
     }
 
-    /* Configuration of DAC Channel 2 OUT2M as line out driver */
-    status = write_1b_register(device, REG_OUT2X_CFG2, COMMON_CFG_OUT2X_CFG2.data);
-    if (status != ESP_OK)
+    /* The link check runs on page 0, the caller goes on with the page it selected */
+    if (page != TAD5212_PAGE_UNKNOWN)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write OUT2X_CFG2 register: %s", esp_err_to_name(status));
-        return status;
+        select_page(device, page);
     }
+}
 
-    /* DAC 2 Volume configuration set to mute */
-    status = write_1b_register(device, REG_DAC_CH2A_CFG0, COMMON_CFG_DAC_CH2A_CFG0.data);
+
+/**
+ *  \brief Check the link at the current I2C speed by writing and reading back patterns, then the
+ *         value the probe register must keep.
+ *  \param device Pointer to TAD5212 handle
+ *  \param restore Value left in the probe register.
+ *  \return ESP_OK if every pattern was read back, error code otherwise.
+ */
+static esp_err_t check_i2c_link(tad5212_handle_t* device, uint8_t restore)
+{
+    const uint8_t patterns[] = TAD5212_I2C_PROBE_PATTERNS;
+    esp_err_t status;
+    uint8_t pattern;
+    uint8_t value;
+
+    status = select_page(device, TAD5212_PAGE_0);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write DAC_CH2A_CFG0 register: %s", esp_err_to_name(status));
         return status;
     }
 
-    /* Subwoofer configuration settings load */
-    if (cfg == TAD5212_CONFIG_SUBWOOFER) 
+    /* The last write restores the register, checked like the patterns */
+    for (size_t i = 0; i <= sizeof(patterns); i++)
     {
-        /* Selects page 1 for registers adressing */
-        status = select_page(device, TAD5212_PAGE_1);
+        pattern = (i < sizeof(patterns)) ? patterns[i] : restore;
+
+        status = write_1b_register(device, TAD5212_I2C_PROBE_REG, pattern);
         if (status != ESP_OK)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to select register page 1: %s", esp_err_to_name(status));
             return status;
         }
 
-        /* DSP configuration */
-        status = write_1b_register(device, REG_MIXER_CFG0, SUBWOOFER_CFG_MIXER_CFG0.data);
+        /* Always from the device, never from the shadow */
+        status = read_1b_register(device, TAD5212_I2C_PROBE_REG, &value);
         if (status != ESP_OK)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to write SUBWOOFER_CFG_MIXER_CFG0 register: %s", esp_err_to_name(status));
             return status;
         }
 
-        /* Mixer configuration */
-        status = tad5212_set_mixer_coeff(device, TAD5212_ASI_DIN_MIX_ASI_CH1, TAD5212_MIXER_RDAC_DIV_2);
-        if (status != ESP_OK)
+        if (value != pattern)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to load mixer L channel gain settings: %s", esp_err_to_name(status));
-            return status;
+            ESP_LOGW(TAD5212_TAG, "0x%02x: read back 0x%02x instead of 0x%02x", device->addr, value, pattern);
+            return ESP_ERR_INVALID_RESPONSE;
         }
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ *  \brief Select the highest reliable I2C speed, starting from a given one.
+ *  \param device Pointer to TAD5212 handle
+ *  \param scl_speed_hz Highest I2C speed to try.
+ *  \return ESP_OK on success, error code if the link fails at standard mode.
+ */
+static esp_err_t negotiate_i2c_speed(tad5212_handle_t* device, uint32_t scl_speed_hz)
+{
+    esp_err_t status;
+    uint32_t speed = scl_speed_hz;
+    uint8_t probe_value = TAD5212_I2C_PROBE_RESET;
+    bool probe_known;
+
+    if (speed > TAD5212_I2C_SPEED_FAST_PLUS)
+    {
+        speed = TAD5212_I2C_SPEED_FAST_PLUS;
+    }
+
+    _lock_acquire(&device->lock);
+    device->i2c_negotiating = true;
+
+    /* The probe register is restored afterwards: reset value at init, shadow value at runtime */
+    probe_known = (device->initialized == false) ||
+                  (device->shadow_valid[TAD5212_PAGE_0][TAD5212_I2C_PROBE_REG / 32] & (1UL << (TAD5212_I2C_PROBE_REG % 32)));
+    if (device->initialized && probe_known)
+    {
+        probe_value = device->shadow[TAD5212_PAGE_0][TAD5212_I2C_PROBE_REG];
+    }
+    _lock_release(&device->lock);
+
+    /* Not in the shadow: read once at the current speed, before any pattern is written */
+    if (!probe_known &&
+        (select_page(device, TAD5212_PAGE_0) != ESP_OK || read_1b_register(device, TAD5212_I2C_PROBE_REG, &probe_value) != ESP_OK))
+    {
+        ESP_LOGW(TAD5212_TAG, "0x%02x: probe register unknown, reset value restored", device->addr);
+        probe_value = TAD5212_I2C_PROBE_RESET;
+    }
+
+    status = ESP_ERR_INVALID_RESPONSE;
 
-        status = tad5212_set_mixer_coeff(device, TAD5212_ASI_DIN_MIX_ASI_CH2, TAD5212_MIXER_RDAC_DIV_2);
+    while (speed != 0)
+    {
+        status = set_i2c_speed(device, speed);
         if (status != ESP_OK)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to load mixer R channel gain settings: %s", esp_err_to_name(status));
-            return status;
+            break;
         }
 
-        /* Biquad filters configuration */
-        status = tad5212_set_biquad_coeff(device, TAD5212_DAC2_BIQUAD_FILTER_1, TAD5212_BIQUAD_LOWPASS_150_HZ);
-        if (status != ESP_OK)
+        status = check_i2c_link(device, probe_value);
+        if (status == ESP_OK)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to load biquad filter settings: %s", esp_err_to_name(status));
-            return status;
+            ESP_LOGI(TAD5212_TAG, "0x%02x: I2C link at %lu Hz", device->addr, (unsigned long)speed);
+            break;
         }
 
-        status = tad5212_set_biquad_coeff(device, TAD5212_DAC2_BIQUAD_FILTER_2, TAD5212_BIQUAD_LOWPASS_150_HZ);
-        if (status != ESP_OK)
+        /* Nothing written at this speed can be trusted */
+        _lock_acquire(&device->lock);
+        shadow_invalidate(device);
+        _lock_release(&device->lock);
+
+        ESP_LOGW(TAD5212_TAG, "0x%02x: I2C link unreliable at %lu Hz", device->addr, (unsigned long)speed);
+        speed = lower_i2c_speed(speed);
+        status = ESP_ERR_INVALID_RESPONSE;
+    }
+
+    _lock_acquire(&device->lock);
+    device->i2c_negotiating = false;
+    _lock_release(&device->lock);
+
+    return status;
+}
+
+
+/**
+ *  \brief Get the crossover cache entry of a sample rate.
+ *  \param sample_rate Sample rate in Hz.
+ *  \return Index in the cache, or -1 if the rate is not supported.
+ */
+static int sample_rate_index(uint32_t sample_rate)
+{
+    for (int i = 0; i < TAD5212_SAMPLE_RATE_COUNT; i++)
+    {
+        if (sample_rates[i] == sample_rate)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to load biquad filter settings: %s", esp_err_to_name(status));
-            return status;
+            return i;
         }
+    }
 
-        /* Selects page 0 for registers adressing */
-        status = select_page(device, TAD5212_PAGE_0);
-        if (status != ESP_OK)
+    return -1;
+}
+
+
+/**
+ *  \brief Design the crossover filters of a topology for every supported sample rate.
+ *  \param device Pointer to TAD5212 handle
+ *  \param crossover Crossover filters, ended by a filter 0.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t build_crossover_cache(tad5212_handle_t* device, const tad5212_crossover_t* crossover)
+{
+    esp_err_t status;
+    uint8_t len = 0;
+
+    for (; crossover[len].filter != 0; len++)
+    {
+        if (len == TAD5212_CROSSOVER_MAX)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to select register page 0: %s", esp_err_to_name(status));
-            return status;
+            ESP_LOGE(TAD5212_TAG, "More than %d crossover filters", TAD5212_CROSSOVER_MAX);
+            return ESP_ERR_INVALID_SIZE;
         }
 
-        /* Enable DAC2 channel */
-        status = write_1b_register(device, REG_CH_EN, SUBWOOFER_CFG_CH_EN.data);
-        if (status != ESP_OK)
+        device->crossover_filter[len] = crossover[len].filter;
+
+        for (int i = 0; i < TAD5212_SAMPLE_RATE_COUNT; i++)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to write CH_EN register: %s", esp_err_to_name(status));
-            return status;
+            status = tad5212_biquad_design(&crossover[len].spec, sample_rates[i], &device->crossover_coeffs[i][len]);
+
+            /* e.g. a corner above the Nyquist frequency: nothing to filter at this rate */
+            if (status != ESP_OK)
+            {
+                ESP_LOGW(TAD5212_TAG, "Filter %d bypassed at %lu Hz: %s", crossover[len].filter,
+                         (unsigned long)sample_rates[i], esp_err_to_name(status));
+                device->crossover_coeffs[i][len] = TAD5212_BIQUAD_PASS_THROUGH;
+            }
         }
+    }
+
+    device->crossover_len = len;
+
+    return ESP_OK;
+}
+
 
-        ESP_LOGE(TAD5212_TAG, "Subwoofer config done: %s", esp_err_to_name(status));
+/**
+ *  \brief Load the cached crossover filters of a sample rate.
+ *  \param device Pointer to TAD5212 handle
+ *  \param index Cache entry of the sample rate.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t load_crossover(tad5212_handle_t* device, int index)
+{
+    esp_err_t status;
+    tad5212_biquad_filter_t filters[TAD5212_CROSSOVER_MAX];
+
+    for (uint8_t i = 0; i < device->crossover_len; i++)
+    {
+        filters[i] = (tad5212_biquad_filter_t)device->crossover_filter[i];
     }
 
-    /* Basic configuration settings load (2x 2-way speakers) */
-    else
+    /* All the filters switch together */
+    status = tad5212_set_biquads(device, filters, device->crossover_coeffs[index], device->crossover_len);
+    if (status != ESP_OK)
     {
-        /* Biquad filters configuration */
+        return status;
+    }
 
-        status = tad5212_set_biquad_coeff(device, TAD5212_DAC1_BIQUAD_FILTER_1, TAD5212_BIQUAD_HIGHPASS_150_HZ);
-        if (status != ESP_OK)
-        {
-            ESP_LOGE(TAD5212_TAG, "Failed to load biquad filter settings: %s", esp_err_to_name(status));
-            return status;
-        }
+    device->sample_rate = sample_rates[index];
 
-        status = tad5212_set_biquad_coeff(device, TAD5212_DAC1_BIQUAD_FILTER_1, TAD5212_BIQUAD_LOWPASS_16000_HZ);
-        if (status != ESP_OK)
+    return ESP_OK;
+}
+
+
+/**
+ *  \brief Get the coefficient slot of a biquad filter.
+ *  \param filter Biquad filter.
+ *  \return Slot index, or -1 if the filter has no programmable coefficients.
+ */
+static int biquad_slot(tad5212_biquad_filter_t filter)
+{
+    for (int i = 0; i < TAD5212_BIQUAD_SLOTS; i++)
+    {
+        if (biquad_slot_filters[i] == filter)
         {
-            ESP_LOGE(TAD5212_TAG, "Failed to load biquad filter settings: %s", esp_err_to_name(status));
-            return status;
+            return i;
         }
+    }
+
+    return -1;
+}
+
+
+/**
+ *  \brief Write the coefficients of a biquad filter in one burst.
+ *  \param device Pointer to TAD5212 handle
+ *  \param filter Biquad filter.
+ *  \param coeffs Coefficients.
+ *  \return ESP_OK on success, error code otherwise.
+ */
+static esp_err_t write_biquad(tad5212_handle_t* device, tad5212_biquad_filter_t filter, const tad5212_biquad_coeffs_t* coeffs)
+{
+    esp_err_t status;
+    uint8_t reg_addr;
+    uint8_t page;
+
+    /* Select register address depending on channel */
+    switch (filter)
+    {
+        case TAD5212_DAC1_BIQUAD_FILTER_1:
+            page = TAD5212_PAGE_15;
+            reg_addr = REG_DAC_BQ1_N0_B1;
+            break;
+
+        case TAD5212_DAC2_BIQUAD_FILTER_1:
+            page = TAD5212_PAGE_15;
+            reg_addr = REG_DAC_BQ2_N0_B1;
+            break;
+
+        case TAD5212_DAC1_BIQUAD_FILTER_2:
+            page = TAD5212_PAGE_15;
+            reg_addr = REG_DAC_BQ5_N0_B1;
+            break;
+
+        case TAD5212_DAC2_BIQUAD_FILTER_2:
+            page = TAD5212_PAGE_15;
+            reg_addr = REG_DAC_BQ6_N0_B1;
+            break;
+
+        case TAD5212_DAC1_BIQUAD_FILTER_3:
+            page = TAD5212_PAGE_16;
+            reg_addr = REG_DAC_BQ9_N0_B1;
+            break;
+
+        case TAD5212_DAC2_BIQUAD_FILTER_3:
+            page = TAD5212_PAGE_16;
+            reg_addr = REG_DAC_BQ10_N0_B1;
+            break;
+
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Selects page for registers addressing */
+    status = select_page(device, page);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page %d: %s", page, esp_err_to_name(status));
+        return status;
+    }
+
+    /* Write the 5 biquad coefficients in one burst */
+    uint8_t data[5 * 4];
+
+    put_4b_value(&data[0], coeffs->n0.value);
+    put_4b_value(&data[4], coeffs->n1.value);
+    put_4b_value(&data[8], coeffs->n2.value);
+    put_4b_value(&data[12], coeffs->d1.value);
+    put_4b_value(&data[16], coeffs->d2.value);
+
+    status = write_burst_register(device, reg_addr, data, sizeof(data));
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to write biquad coefficients: %s", esp_err_to_name(status));
+        return status;
+    }
+
+    return ESP_OK;
+}
+
+
+/*** Public functions ***********************************************************************/
+
+
+/**
+ *  \brief Initialize the TAD5212 codec
+ *  \param device TAD5212 device
+ *  \param i2c_bus_handle I2C bus handler
+ *  \param i2c_addr I2C address of the TAD5212 device
+ *  \param cfg Topology to load
+ *  \param scl_speed_hz Highest I2C speed to try, lowered until the link is reliable
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_init(tad5212_handle_t* device, i2c_master_bus_handle_t i2c_bus_handle, tad5212_i2c_addr_t i2c_addr, 
+                       tad5212_config_select_t cfg, uint32_t scl_speed_hz)
+{
+    esp_err_t status;
+    
+    if (device == NULL)
+    {
+        ESP_LOGE(TAD5212_TAG, "Device handler NULL");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Check device initialization state */
+    if (device->initialized == true) 
+    {
+        ESP_LOGE(TAD5212_TAG, "Device already initialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    _lock_init(&device->lock);
+
+    /* Nothing is known of the device state before the reset */
+    shadow_invalidate(device);
+
+    /* Filters hold their reset values */
+    for (int i = 0; i < TAD5212_BIQUAD_SLOTS; i++)
+    {
+        device->biquad[i] = TAD5212_BIQUAD_PASS_THROUGH;
+    }
+
+    /* Initialize I2C interface */
+    if (i2c_bus_handle == NULL)
+    {
+        ESP_LOGE(TAD5212_TAG, "I2C bus handle NULL");
+        return ESP_ERR_INVALID_ARG;
+    }
+    else
+    {
+        device->bus = i2c_bus_handle;
+    }
+
+    if (i2c_addr != TAD5212_I2C_ADDR_SHORT && 
+        i2c_addr != TAD5212_I2C_ADDR_PD_4_7K &&
+        i2c_addr != TAD5212_I2C_ADDR_PU_4_7K && 
+        i2c_addr != TAD5212_I2C_ADDR_PU_22K)
+    {
+        ESP_LOGE(TAD5212_TAG, "TAD5212 I2C address unknown");
+        return ESP_ERR_INVALID_ARG;
+    }
+    else
+    {
+        device->addr = i2c_addr;
+    }
+
+    /* Create device at the highest speed the link supports */
+    device->i2c_fallback = false;
+    status = negotiate_i2c_speed(device, scl_speed_hz);
 
-        status = tad5212_set_biquad_coeff(device, TAD5212_DAC2_BIQUAD_FILTER_1, TAD5212_BIQUAD_HIGHPASS_150_HZ);
-        if (status != ESP_OK)
-        {
-            ESP_LOGE(TAD5212_TAG, "Failed to load biquad filter settings: %s", esp_err_to_name(status));
-            return status;
-        }
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "I2C link check failed: %s", esp_err_to_name(status));
+        return status;
+    }
 
-        status = tad5212_set_biquad_coeff(device, TAD5212_DAC2_BIQUAD_FILTER_1, TAD5212_BIQUAD_LOWPASS_16000_HZ);
-        if (status != ESP_OK)
-        {
-            ESP_LOGE(TAD5212_TAG, "Failed to load biquad filter settings: %s", esp_err_to_name(status));
-            return status;
-        }
+    /* Reset and common configuration */
+    status = run_init_sequence(device, COMMON_CFG_INIT_SEQUENCE);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to load common configuration: %s", esp_err_to_name(status));
+        return status;
+    }
 
-        /* Selects page 0 for registers adressing */
-        status = select_page(device, TAD5212_PAGE_0);
-        if (status != ESP_OK)
-        {
-            ESP_LOGE(TAD5212_TAG, "Failed to select register page 0: %s", esp_err_to_name(status));
-            return status;
-        }
+    /* Topology configuration */
+    status = run_init_sequence(device, (cfg == TAD5212_CONFIG_SUBWOOFER) ? SUBWOOFER_CFG_INIT_SEQUENCE 
+                                                                         : STEREO_CFG_INIT_SEQUENCE);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to load %s configuration: %s", 
+                 (cfg == TAD5212_CONFIG_SUBWOOFER) ? "subwoofer" : "stereo", esp_err_to_name(status));
+        return status;
+    }
 
-        /* Enable DAC1 & DAC2 channels */
-        status = write_1b_register(device, REG_CH_EN, COMMON_CFG_CH_EN.data);
-        if (status != ESP_OK)
-        {
-            ESP_LOGE(TAD5212_TAG, "Failed to write CH_EN register: %s", esp_err_to_name(status));
-            return status;
-        }
+    /* Crossover filters of the topology, designed once for every supported sample rate */
+    status = build_crossover_cache(device, (cfg == TAD5212_CONFIG_SUBWOOFER) ? SUBWOOFER_CFG_CROSSOVER
+                                                                             : STEREO_CFG_CROSSOVER);
+    if (status == ESP_OK)
+    {
+        status = load_crossover(device, sample_rate_index(TAD5212_SAMPLE_RATE_DEFAULT));
+    }
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to load crossover filters: %s", esp_err_to_name(status));
+        return status;
     }
 
     /* Power up the device */
-    status = write_1b_register(device, REG_PWR_CFG, COMMON_CFG_PWR_CFG.data);
+    status = run_init_sequence(device, COMMON_CFG_POWER_UP_SEQUENCE);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write PWR_CFG register: %s", esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "Failed to power up the device: %s", esp_err_to_name(status));
         return status;
     }
 
@@ -639,6 +1327,7 @@ esp_err_t tad5212_deinit(tad5212_handle_t* device)
     }
 
     /* End of deinitialization */
+    shadow_invalidate(device);
     device->initialized = false;
 
     return ESP_OK;
@@ -652,10 +1341,25 @@ esp_err_t tad5212_deinit(tad5212_handle_t* device)
  *  \return ESP_OK on success, error code otherwise.
  */
 esp_err_t tad5212_set_biquad_coeff(tad5212_handle_t* device, tad5212_biquad_filter_t filter, tad5212_biquad_coeffs_t coeffs)
+{
+    return tad5212_set_biquads(device, &filter, &coeffs, 1);
+}
+
+
+/**
+ *  \brief Replace the coefficients of several biquad filters. Only the filters whose coefficients
+ *         change are written, in place, one I2C burst per filter.
+ *  \param device TAD5212 device
+ *  \param filters Biquad filters to set
+ *  \param coeffs Coefficients of each filter
+ *  \param count Number of filters
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_set_biquads(tad5212_handle_t* device, const tad5212_biquad_filter_t* filters,
+                              const tad5212_biquad_coeffs_t* coeffs, size_t count)
 {
     esp_err_t status;
-    uint8_t reg_addr;
-    uint8_t page;
+    int slot;
 
     /* Check device handler */
     if (device == NULL) 
@@ -664,37 +1368,69 @@ esp_err_t tad5212_set_biquad_coeff(tad5212_handle_t* device, tad5212_biquad_filt
         return ESP_ERR_INVALID_STATE;
     }
 
-    /* Select register address depending on channel */
-    switch (filter)
+    if (filters == NULL || coeffs == NULL)
     {
-        case TAD5212_DAC1_BIQUAD_FILTER_1:
-            page = TAD5212_PAGE_15;
-            reg_addr = REG_DAC_BQ1_N0_B1;
-            break;
+        return ESP_ERR_INVALID_ARG;
+    }
 
-        case TAD5212_DAC2_BIQUAD_FILTER_1:
-            page = TAD5212_PAGE_15;
-            reg_addr = REG_DAC_BQ2_N0_B1;
-            break;
+    /* Check every filter before writing any */
+    for (size_t i = 0; i < count; i++)
+    {
+        if (biquad_slot(filters[i]) < 0)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
 
-        case TAD5212_DAC1_BIQUAD_FILTER_2:
-            page = TAD5212_PAGE_15;
-            reg_addr = REG_DAC_BQ5_N0_B1;
-            break;
+    for (size_t i = 0; i < count; i++)
+    {
+        slot = biquad_slot(filters[i]);
 
-        case TAD5212_DAC2_BIQUAD_FILTER_2:
-            page = TAD5212_PAGE_15;
-            reg_addr = REG_DAC_BQ6_N0_B1;
-            break;
+        /* A filter left unchanged is not disturbed */
+        if (memcmp(&device->biquad[slot], &coeffs[i], sizeof(tad5212_biquad_coeffs_t)) == 0)
+        {
+            continue;
+        }
 
-        case TAD5212_DAC1_BIQUAD_FILTER_3:
-            page = TAD5212_PAGE_16;
-            reg_addr = REG_DAC_BQ9_N0_B1;
+        status = write_biquad(device, filters[i], &coeffs[i]);
+        if (status != ESP_OK)
+        {
+            return status;
+        }
+        device->biquad[slot] = coeffs[i];
+    }
+
+    return ESP_OK;
+}
+
+/**
+ *  \brief Set mixer coefficients
+ *  \param device TAD5212 device
+ *  \param mixer Mixer to set the coefficients
+ *  \param coeffs Mixer coefficients
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_set_mixer_coeff(tad5212_handle_t* device, tad5212_mixer_t mixer, tad5212_mixer_coeffs_t coeffs)
+{
+    esp_err_t status;
+    uint8_t reg_addr;
+
+    /* Check device handler */
+    if (device == NULL) 
+    {
+        ESP_LOGE(TAD5212_TAG, "Device already deinitialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Select register address depending on channel */
+    switch (mixer)
+    {
+        case TAD5212_ASI_DIN_MIX_ASI_CH1:
+            reg_addr = REG_ASI_DIN_MIX_ASI_CH1_RDAC_MIX_BYT1;
             break;
 
-        case TAD5212_DAC2_BIQUAD_FILTER_3:
-            page = TAD5212_PAGE_16;
-            reg_addr = REG_DAC_BQ10_N0_B1;
+        case TAD5212_ASI_DIN_MIX_ASI_CH2:
+            reg_addr = REG_ASI_DIN_MIX_ASI_CH2_RDAC_MIX_BYT1;
             break;
 
         default:
@@ -702,46 +1438,95 @@ esp_err_t tad5212_set_biquad_coeff(tad5212_handle_t* device, tad5212_biquad_filt
     }
 
     /* Selects page for registers addressing */
-    status = select_page(device, page);
+    status = select_page(device, TAD5212_PAGE_17);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to select register page %d: %s", page, esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page %d: %s", TAD5212_PAGE_17, esp_err_to_name(status));
+        return status;
+    }
+
+    /* Write the mixer row in one burst */
+    uint8_t data[2 * 4];
+
+    put_4b_value(&data[0], ((uint32_t)coeffs.a2.value << 16) | coeffs.a1.value);
+    put_4b_value(&data[4], ((uint32_t)coeffs.a4.value << 16) | coeffs.a3.value);
+
+    status = write_burst_register(device, reg_addr, data, sizeof(data));
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to write mixer coefficients: %s", esp_err_to_name(status));
         return status;
     }
 
-    /* Write biquad coefficients */
-    status = write_4b_register(device, reg_addr, coeffs.n0.value);
+    return ESP_OK;
+}
+
+/**
+ *  \brief Load the whole ASI DIN mixer matrix in one burst and enable the mixer
+ *  \param device TAD5212 device
+ *  \param coeffs TAD5212_MIXER_INPUTS rows of coefficients, see tad5212_mixer_matrix_coeffs()
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_set_mixer_matrix(tad5212_handle_t* device, const tad5212_mixer_coeffs_t* coeffs)
+{
+    esp_err_t status;
+    tad5212_REG_MIXER_CFG0_t mixer_cfg;
+    uint8_t data[TAD5212_MIXER_INPUTS * 2 * 4];
+
+    /* Check device handler */
+    if (device == NULL || device->initialized == false) 
+    {
+        ESP_LOGE(TAD5212_TAG, "Device already deinitialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (coeffs == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Rows of ASI CH1 and CH2 are contiguous */
+    for (int i = 0; i < TAD5212_MIXER_INPUTS; i++)
+    {
+        put_4b_value(&data[i * 8], ((uint32_t)coeffs[i].a2.value << 16) | coeffs[i].a1.value);
+        put_4b_value(&data[i * 8 + 4], ((uint32_t)coeffs[i].a4.value << 16) | coeffs[i].a3.value);
+    }
+
+    status = select_page(device, TAD5212_PAGE_17);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write biquad coefficient N0: %s", esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page %d: %s", TAD5212_PAGE_17, esp_err_to_name(status));
         return status;
     }
 
-    status = write_4b_register(device, reg_addr + 4, coeffs.n1.value);
+    status = write_burst_register(device, REG_ASI_DIN_MIX_ASI_CH1_RDAC_MIX_BYT1, data, sizeof(data));
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write biquad coefficients N1: %s", esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "Failed to write mixer matrix: %s", esp_err_to_name(status));
         return status;
     }
 
-    status = write_4b_register(device, reg_addr + 8, coeffs.n2.value);
+    /* Mixer enabled once its coefficients are loaded, skipped when already enabled */
+    status = select_page(device, TAD5212_PAGE_1);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write biquad coefficients N2: %s", esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page %d: %s", TAD5212_PAGE_1, esp_err_to_name(status));
         return status;
     }
 
-    status = write_4b_register(device, reg_addr + 12, coeffs.d1.value);
+    status = read_1b_register_cached(device, REG_MIXER_CFG0, &mixer_cfg.data);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write biquad coefficients D1: %s", esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "Failed to read MIXER_CFG0 register: %s", esp_err_to_name(status));
         return status;
     }
 
-    status = write_4b_register(device, reg_addr + 16, coeffs.d2.value);
+    mixer_cfg.en_dac_asi_mixer = 1;
+
+    status = write_1b_register(device, REG_MIXER_CFG0, mixer_cfg.data);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write biquad coefficients D2: %s", esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "Failed to enable the mixer: %s", esp_err_to_name(status));
         return status;
     }
 
@@ -749,65 +1534,87 @@ esp_err_t tad5212_set_biquad_coeff(tad5212_handle_t* device, tad5212_biquad_filt
 }
 
 /**
- *  \brief Set mixer coefficients
+ *  \brief Write consecutive registers of a page, in one burst
  *  \param device TAD5212 device
- *  \param mixer Mixer to set the coefficients
- *  \param coeffs Mixer coefficients
+ *  \param page Register page
+ *  \param reg First register address
+ *  \param data Register values
+ *  \param len Number of registers
  *  \return ESP_OK on success, error code otherwise.
  */
-esp_err_t tad5212_set_mixer_coeff(tad5212_handle_t* device, tad5212_mixer_t mixer, tad5212_mixer_coeffs_t coeffs)
+esp_err_t tad5212_write_registers(tad5212_handle_t* device, uint8_t page, uint8_t reg, const uint8_t* data, size_t len)
 {
-    esp_err_t status;
-    uint8_t reg_addr;
-
     /* Check device handler */
-    if (device == NULL) 
+    if (device == NULL || device->initialized == false) 
     {
         ESP_LOGE(TAD5212_TAG, "Device already deinitialized");
         return ESP_ERR_INVALID_STATE;
     }
 
-    /* Select register address depending on channel */
-    switch (mixer)
+    esp_err_t status = select_page(device, page);
+
+    if (status != ESP_OK)
     {
-        case TAD5212_ASI_DIN_MIX_ASI_CH1:
-            reg_addr = REG_ASI_DIN_MIX_ASI_CH1_RDAC_MIX_BYT1;
-            break;
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page %d: %s", page, esp_err_to_name(status));
+        return status;
+    }
 
-        case TAD5212_ASI_DIN_MIX_ASI_CH2:
-            reg_addr = REG_ASI_DIN_MIX_ASI_CH2_RDAC_MIX_BYT1;
-            break;
+    /* Single registers go through the shadow, unchanged values are skipped */
+    if (len == 1)
+    {
+        return write_1b_register(device, reg, data[0]);
+    }
 
-        default:
-            return ESP_ERR_INVALID_ARG;
+    return write_burst_register(device, reg, data, len);
+}
+
+
+/**
+ *  \brief Retune the crossover filters for a sample rate, by loading coefficients designed at init
+ *  \param device TAD5212 device
+ *  \param sample_rate Sample rate of the audio stream in Hz
+ *  \return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if no coefficients are cached for this rate,
+ *          error code otherwise.
+ */
+esp_err_t tad5212_set_sample_rate(tad5212_handle_t* device, uint32_t sample_rate)
+{
+    esp_err_t status;
+    int index;
+
+    /* Check device initialization state */
+    if (device == NULL || device->initialized == false) 
+    {
+        ESP_LOGE(TAD5212_TAG, "Device not initialized");
+        return ESP_ERR_INVALID_STATE;
     }
 
-    /* Selects page for registers addressing */
-    status = select_page(device, TAD5212_PAGE_17);
-    if (status != ESP_OK)
+    index = sample_rate_index(sample_rate);
+    if (index < 0)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to select register page %d: %s", TAD5212_PAGE_17, esp_err_to_name(status));
-        return status;
+        ESP_LOGW(TAD5212_TAG, "No crossover filters for %lu Hz, kept at %lu Hz", 
+                 (unsigned long)sample_rate, (unsigned long)device->sample_rate);
+        return ESP_ERR_NOT_SUPPORTED;
     }
 
-    /* Write mixer coefficients */
-    status = write_4b_register(device, reg_addr, (uint32_t)(coeffs.a2.value << 16) + coeffs.a1.value);
-    if (status != ESP_OK)
+    /* Already tuned */
+    if (sample_rate == device->sample_rate)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write mixer coefficient A2 + A1: %s", esp_err_to_name(status));
-        return status;
+        return ESP_OK;
     }
 
-    status = write_4b_register(device, reg_addr + 4, (uint32_t)(coeffs.a4.value << 16) + coeffs.a3.value);
+    status = load_crossover(device, index);
     if (status != ESP_OK)
     {
-        ESP_LOGE(TAD5212_TAG, "Failed to write mixer coefficient A4 + A3: %s", esp_err_to_name(status));
+        ESP_LOGE(TAD5212_TAG, "Failed to load crossover filters: %s", esp_err_to_name(status));
         return status;
     }
 
+    ESP_LOGI(TAD5212_TAG, "0x%02x: crossover filters tuned for %lu Hz", device->addr, (unsigned long)sample_rate);
+
     return ESP_OK;
 }
 
+
 /**
  *  \brief Set the volume of the TAD5212 codec
  *  \param device TAD5212 device
@@ -836,8 +1643,14 @@ esp_err_t tad5212_set_volume(tad5212_handle_t* device, tad5212_channel_t channel
         dvol_value = TAD5212_DAC_MIN_VOLUME + (uint8_t)(TAD5212_DAC_VOLUME_STEP * volume);
     }
 
-    // Write volume to the selected channel(s)
-    esp_err_t status;
+    // Write volume to the selected channel(s), registers of page 0
+    esp_err_t status = select_page(device, TAD5212_PAGE_0);
+
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page 0: %s", esp_err_to_name(status));
+        return status;
+    }
 
     if (channel == TAD5212_CHANNEL_LEFT || channel == TAD5212_CHANNEL_BOTH) 
     {
@@ -890,9 +1703,18 @@ esp_err_t tad5212_swap_channels(tad5212_handle_t* device)
         return ESP_ERR_INVALID_STATE;
     }
 
-    /* Reading of current register value */
+    /* Registers of page 0, page select skipped when already selected */
+    esp_err_t status = select_page(device, TAD5212_PAGE_0);
+
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page 0: %s", esp_err_to_name(status));
+        return status;
+    }
+
+    /* Current register value, from the shadow once written */
     uint8_t reg_value = 0;
-    esp_err_t status = read_1b_register(device, REG_DYN_PUPD_CFG, &reg_value);
+    status = read_1b_register_cached(device, REG_DYN_PUPD_CFG, &reg_value);
 
     if (status != ESP_OK)
     {
@@ -915,6 +1737,59 @@ esp_err_t tad5212_swap_channels(tad5212_handle_t* device)
     return ESP_OK;
 }
 
+/**
+ *  \brief Get the group delay of the TAD5212 DAC path, set by the interpolation filter response
+ *  \param device TAD5212 device
+ *  \param frames Pointer to store the delay, in frames at the audio sample rate
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_get_group_delay_frames(tad5212_handle_t* device, uint32_t* frames)
+{
+    /* Check device handler */
+    if (device == NULL || device->initialized == false || frames == NULL) 
+    {
+        ESP_LOGE(TAD5212_TAG, "Device already deinitialized");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Registers of page 0, page select skipped when already selected */
+    esp_err_t status = select_page(device, TAD5212_PAGE_0);
+
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page 0: %s", esp_err_to_name(status));
+        return status;
+    }
+
+    /* Current register value, from the shadow once read or written */
+    uint8_t reg_value = 0;
+    status = read_1b_register_cached(device, REG_DSP_CFG1, &reg_value);
+
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to read DSP_CFG1 register: %s", esp_err_to_name(status));
+        return status;
+    }
+
+    /* Biquads are IIR, their delay is negligible next to the interpolation filter */
+    switch (((tad5212_REG_DSP_CFG1_t*)&reg_value)->dac_dsp_deci_filt)
+    {
+        case 0:
+            *frames = TAD5212_DAC_DELAY_LINEAR_PHASE;
+            break;
+
+        case 1:
+            *frames = TAD5212_DAC_DELAY_LOW_LATENCY;
+            break;
+
+        default:
+            *frames = TAD5212_DAC_DELAY_ULTRA_LOW;
+            break;
+    }
+
+    return ESP_OK;
+}
+
 #ifdef TAD5212_DEBUG
 
 /**
@@ -935,9 +1810,17 @@ esp_err_t tad5212_dac_status(tad5212_handle_t* device)
     ESP_LOGI(TAD5212_TAG, "TAD5212 : 0x%02x - LOG", device->addr);
     ESP_LOGI(TAD5212_TAG, "=====================================");
 
+    esp_err_t status = select_page(device, TAD5212_PAGE_0);
+
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_TAG, "Failed to select register page 0: %s", esp_err_to_name(status));
+        return status;
+    }
+
     uint8_t reg_value_1;
 
-    esp_err_t status = read_1b_register(device, REG_DEV_STS0, &reg_value_1);
+    status = read_1b_register(device, REG_DEV_STS0, &reg_value_1);
 
     if (status != ESP_OK)
     {
@@ -19,6 +19,9 @@
 #include "esp_check.h"
 #include "esp_log.h"
 
+#include "tad5212_biquad_design.h"
+#include "tad5212_mixer_matrix.h"
+
 /*** Defines **************************************************************************/
 
 /* log tag */
@@ -27,6 +30,29 @@
 /* Debug mode */
 #define TAD5212_DEBUG
 
+/* Register shadow: 1 byte register pages (0 and 1), 128 registers each */
+#define TAD5212_SHADOW_PAGES    2
+#define TAD5212_SHADOW_REGS     128
+
+/* I2C bus speeds supported by the device */
+#define TAD5212_I2C_SPEED_STANDARD      100000      /* Standard mode */
+#define TAD5212_I2C_SPEED_FAST          400000      /* Fast mode */
+#define TAD5212_I2C_SPEED_FAST_PLUS     1000000     /* Fast mode plus */
+
+/* Sample rates the crossover filters are designed for at init */
+#define TAD5212_SAMPLE_RATES            { 32000, 44100, 48000 }
+#define TAD5212_SAMPLE_RATE_COUNT       3
+#define TAD5212_SAMPLE_RATE_DEFAULT     44100       /* Rate loaded at init, before any stream configuration */
+
+/* DAC biquad filters with programmable coefficients (3 per DAC channel) */
+#define TAD5212_BIQUAD_SLOTS            6
+
+/* Crossover filters of a topology */
+#define TAD5212_CROSSOVER_MAX           4
+
+/* Selected page not known, e.g. before init or after a failed page write */
+#define TAD5212_PAGE_UNKNOWN    0xFF
+
 /*** Enumerations *********************************************************************/
 
 /* TAD5212 configuration types */
@@ -65,6 +91,18 @@ typedef struct
     tad5212_i2c_addr_t      addr;
     _lock_t                 lock;
     bool                    initialized;
+    uint32_t                scl_speed_hz;   /* I2C speed in use */
+    uint8_t                 i2c_errors;     /* Consecutive I2C transaction errors */
+    bool                    i2c_fallback;   /* Error limit reached, speed lowered after the transaction */
+    bool                    i2c_negotiating;/* Speed being negotiated, errors are not counted */
+    uint8_t                 page;           /* Page currently selected */
+    uint8_t                 shadow[TAD5212_SHADOW_PAGES][TAD5212_SHADOW_REGS];              /* Last value written or read */
+    uint32_t                shadow_valid[TAD5212_SHADOW_PAGES][TAD5212_SHADOW_REGS / 32];   /* Shadow entries in use */
+    tad5212_biquad_coeffs_t biquad[TAD5212_BIQUAD_SLOTS];                                          /* Coefficients of each biquad slot */
+    uint32_t                sample_rate;    /* Sample rate the crossover filters are tuned for */
+    uint8_t                 crossover_len;  /* Crossover filters of the topology */
+    uint8_t                 crossover_filter[TAD5212_CROSSOVER_MAX];                               /* Biquad filters retuned on a rate change */
+    tad5212_biquad_coeffs_t crossover_coeffs[TAD5212_SAMPLE_RATE_COUNT][TAD5212_CROSSOVER_MAX];    /* Coefficients per sample rate */
 } 
 tad5212_handle_t;
 
@@ -75,9 +113,12 @@ tad5212_handle_t;
  *  \param device TAD5212 device
  *  \param i2c_bus_handle I2C bus handler
  *  \param i2c_addr I2C address of the TAD5212 device
+ *  \param cfg Topology to load
+ *  \param scl_speed_hz Highest I2C speed to try, lowered until the link is reliable
  *  \return ESP_OK on success, error code otherwise.
  */
-esp_err_t tad5212_init(tad5212_handle_t* device, i2c_master_bus_handle_t i2c_bus_handle, tad5212_i2c_addr_t i2c_addr, tad5212_config_select_t cfg);
+esp_err_t tad5212_init(tad5212_handle_t* device, i2c_master_bus_handle_t i2c_bus_handle, tad5212_i2c_addr_t i2c_addr, 
+                       tad5212_config_select_t cfg, uint32_t scl_speed_hz);
 
 
 /**
@@ -88,6 +129,50 @@ esp_err_t tad5212_init(tad5212_handle_t* device, i2c_master_bus_handle_t i2c_bus
 esp_err_t tad5212_dac_status(tad5212_handle_t* device);
 
 
+/**
+ *  \brief Write consecutive registers of a page, in one burst
+ *  \param device TAD5212 device
+ *  \param page Register page
+ *  \param reg First register address
+ *  \param data Register values
+ *  \param len Number of registers
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_write_registers(tad5212_handle_t* device, uint8_t page, uint8_t reg, const uint8_t* data, size_t len);
+
+
+/**
+ *  \brief Replace the coefficients of several biquad filters. Only the filters whose coefficients
+ *         change are written, in place, one I2C burst per filter.
+ *  \param device TAD5212 device
+ *  \param filters Biquad filters to set
+ *  \param coeffs Coefficients of each filter
+ *  \param count Number of filters
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_set_biquads(tad5212_handle_t* device, const tad5212_biquad_filter_t* filters,
+                              const tad5212_biquad_coeffs_t* coeffs, size_t count);
+
+
+/**
+ *  \brief Load the whole ASI DIN mixer matrix in one burst and enable the mixer
+ *  \param device TAD5212 device
+ *  \param coeffs TAD5212_MIXER_INPUTS rows of coefficients, see tad5212_mixer_matrix_coeffs()
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_set_mixer_matrix(tad5212_handle_t* device, const tad5212_mixer_coeffs_t* coeffs);
+
+
+/**
+ *  \brief Retune the crossover filters for a sample rate, by loading coefficients designed at init
+ *  \param device TAD5212 device
+ *  \param sample_rate Sample rate of the audio stream in Hz
+ *  \return ESP_OK on success, ESP_ERR_NOT_SUPPORTED if no coefficients are cached for this rate,
+ *          error code otherwise.
+ */
+esp_err_t tad5212_set_sample_rate(tad5212_handle_t* device, uint32_t sample_rate);
+
+
 /**
  *  \brief Set the volume of the TAD5212 codec
  *  \param channel Channel to set volume
@@ -105,6 +190,15 @@ esp_err_t tad5212_set_volume(tad5212_handle_t* device, tad5212_channel_t channel
 esp_err_t tad5212_swap_channels(tad5212_handle_t* device);
 
 
+/**
+ *  \brief Get the group delay of the TAD5212 DAC path, set by the interpolation filter response
+ *  \param device TAD5212 device
+ *  \param frames Pointer to store the delay, in frames at the audio sample rate
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_get_group_delay_frames(tad5212_handle_t* device, uint32_t* frames);
+
+
 /**
  *  \brief Deinitialize the TAD5212 codec
  *  \param device TAD5212 device
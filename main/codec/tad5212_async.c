@@ -0,0 +1,496 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Asynchronous command queue of TAD5212 audio CODECs
+ *
+ * No licence
+ */
+
+/*** Includes ***********************************************************************/
+
+#include <string.h>
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "tad5212_async.h"
+#include "log/deferred_log.h"
+
+/*** Defines ***********************************************************************/
+
+#define TAD5212_ASYNC_STACK_SIZE    3072
+
+/* commands taken by the worker at once, superseded ones are merged */
+#define TAD5212_ASYNC_BATCH_LEN     8
+
+/* no later command replaces this one */
+#define TAD5212_ASYNC_NONE          (-1)
+
+/*** Enumerations ***************************************************************************/
+
+typedef enum
+{
+    TAD5212_ASYNC_WRITE = 0,        /* Consecutive registers of a page */
+    TAD5212_ASYNC_VOLUME,           /* Volume of a channel */
+    TAD5212_ASYNC_SAMPLE_RATE,      /* Crossover filters of a sample rate */
+    TAD5212_ASYNC_MIXER,            /* Mixer matrix */
+    TAD5212_ASYNC_CALL,             /* Codec operation */
+}
+tad5212_async_type_t;
+
+/*** Structures *****************************************************************************/
+
+/* Queued command */
+typedef struct
+{
+    uint8_t type;                                           /* Command type (tad5212_async_type_t) */
+    uint8_t num_devices;                                    /* Codecs targeted */
+    uint8_t page;                                           /* Register page of a write */
+    uint8_t reg;                                            /* First register of a write */
+    uint8_t len;                                            /* Registers of a write */
+    uint8_t channel;                                        /* Channel of a volume change */
+    uint8_t volume;                                         /* Volume level of a volume change */
+    uint32_t sample_rate;                                   /* Sample rate of a filters reload */
+    uint8_t data[TAD5212_ASYNC_DATA_MAX];                   /* Register values of a write, mixer coefficients */
+    tad5212_handle_t* devices[TAD5212_ASYNC_DEVICES_MAX];   /* Codecs targeted */
+    tad5212_async_fn_t fn;                                  /* Codec operation of a call */
+    tad5212_async_cb_t cb;                                  /* Completion callback */
+    void* arg;                                              /* Argument of the completion callback */
+}
+tad5212_async_cmd_t;
+
+/*** Static variables ***********************************************************************/
+
+static QueueHandle_t s_queue = NULL;
+static StaticQueue_t s_queue_buffer;
+static uint8_t s_queue_storage[TAD5212_ASYNC_QUEUE_LEN * sizeof(tad5212_async_cmd_t)];
+
+static TaskHandle_t s_task_handle = NULL;
+static StaticTask_t s_task_buffer;
+static StackType_t s_task_stack[TAD5212_ASYNC_STACK_SIZE];
+
+/* worker task only */
+static tad5212_async_cmd_t s_batch[TAD5212_ASYNC_BATCH_LEN];
+static esp_err_t s_batch_status[TAD5212_ASYNC_BATCH_LEN];
+static int s_batch_superseded[TAD5212_ASYNC_BATCH_LEN];
+
+DEFERRED_LOG_SITE(s_log_queue_full, TAD5212_ASYNC_TAG, ESP_LOG_WARN, 1000, "Command queue full, command type %" PRIu32 " dropped");
+
+/*** Prototypes *****************************************************************************/
+
+/**
+ * \brief Queue a command, never blocks.
+ * \param cmd Command, copied.
+ * \param devices Codecs targeted.
+ * \param num_devices Number of codecs.
+ * \return ESP_OK if queued, otherwise an error code.
+ */
+static esp_err_t tad5212_async_queue(tad5212_async_cmd_t* cmd, tad5212_handle_t* const* devices, size_t num_devices);
+
+
+/**
+ * \brief Check if a later command makes an earlier one useless.
+ * \param earlier Command queued first.
+ * \param later Command queued after.
+ * \return true if the later command replaces the earlier one, false otherwise.
+ */
+static bool tad5212_async_supersedes(const tad5212_async_cmd_t* earlier, const tad5212_async_cmd_t* later);
+
+
+/**
+ * \brief Apply a command to each of its codecs.
+ * \param cmd Command.
+ * \return ESP_OK on success, the first error otherwise.
+ */
+static esp_err_t tad5212_async_execute(const tad5212_async_cmd_t* cmd);
+
+
+/**
+ * \brief Worker task: takes the queued commands in batches, skips the superseded ones and
+ *        applies the others in order.
+ * \param arg Unused.
+ */
+static void tad5212_async_task(void* arg);
+
+/*** Static functions ***********************************************************************/
+
+/**
+ * \brief Queue a command, never blocks.
+ * \param cmd Command, copied.
+ * \param devices Codecs targeted.
+ * \param num_devices Number of codecs.
+ * \return ESP_OK if queued, otherwise an error code.
+ */
+static esp_err_t tad5212_async_queue(tad5212_async_cmd_t* cmd, tad5212_handle_t* const* devices, size_t num_devices)
+{
+    if (s_queue == NULL)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (devices == NULL || num_devices == 0 || num_devices > TAD5212_ASYNC_DEVICES_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (size_t i = 0; i < num_devices; i++)
+    {
+        if (devices[i] == NULL)
+        {
+            return ESP_ERR_INVALID_ARG;
+        }
+        cmd->devices[i] = devices[i];
+    }
+    cmd->num_devices = num_devices;
+
+    if (xQueueSend(s_queue, cmd, 0) != pdTRUE)
+    {
+        deferred_log_push(&s_log_queue_full, cmd->type, 0);
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ * \brief Check if a later command makes an earlier one useless.
+ * \param earlier Command queued first.
+ * \param later Command queued after.
+ * \return true if the later command replaces the earlier one, false otherwise.
+ */
+static bool tad5212_async_supersedes(const tad5212_async_cmd_t* earlier, const tad5212_async_cmd_t* later)
+{
+    if (earlier->type != later->type || earlier->num_devices != later->num_devices)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < earlier->num_devices; i++)
+    {
+        if (earlier->devices[i] != later->devices[i])
+        {
+            return false;
+        }
+    }
+
+    switch (earlier->type)
+    {
+        case TAD5212_ASYNC_WRITE:
+            return (earlier->page == later->page && earlier->reg == later->reg && earlier->len == later->len);
+
+        case TAD5212_ASYNC_VOLUME:
+            return (earlier->channel == later->channel);
+
+        case TAD5212_ASYNC_SAMPLE_RATE:
+        case TAD5212_ASYNC_MIXER:
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+
+/**
+ * \brief Apply a command to each of its codecs.
+ * \param cmd Command.
+ * \return ESP_OK on success, the first error otherwise.
+ */
+static esp_err_t tad5212_async_execute(const tad5212_async_cmd_t* cmd)
+{
+    esp_err_t result = ESP_OK;
+    esp_err_t status;
+
+    for (size_t i = 0; i < cmd->num_devices; i++)
+    {
+        switch (cmd->type)
+        {
+            case TAD5212_ASYNC_WRITE:
+                status = tad5212_write_registers(cmd->devices[i], cmd->page, cmd->reg, cmd->data, cmd->len);
+                break;
+
+            case TAD5212_ASYNC_VOLUME:
+                status = tad5212_set_volume(cmd->devices[i], (tad5212_channel_t)cmd->channel, cmd->volume);
+                break;
+
+            case TAD5212_ASYNC_SAMPLE_RATE:
+                status = tad5212_set_sample_rate(cmd->devices[i], cmd->sample_rate);
+                break;
+
+            case TAD5212_ASYNC_MIXER:
+            {
+                tad5212_mixer_coeffs_t coeffs[TAD5212_MIXER_INPUTS];
+
+                memcpy(coeffs, cmd->data, sizeof(coeffs));
+                status = tad5212_set_mixer_matrix(cmd->devices[i], coeffs);
+                break;
+            }
+
+            case TAD5212_ASYNC_CALL:
+                status = cmd->fn(cmd->devices[i]);
+                break;
+
+            default:
+                status = ESP_ERR_INVALID_ARG;
+                break;
+        }
+
+        /* Keep going with the other codecs, report the first error */
+        if (status != ESP_OK && result == ESP_OK)
+        {
+            result = status;
+        }
+    }
+
+    return result;
+}
+
+
+/**
+ * \brief Worker task: takes the queued commands in batches, skips the superseded ones and
+ *        applies the others in order.
+ * \param arg Unused.
+ */
+static void tad5212_async_task(void* arg)
+{
+    size_t count;
+
+    for (;;)
+    {
+        xQueueReceive(s_queue, &s_batch[0], portMAX_DELAY);
+        count = 1;
+
+        while (count < TAD5212_ASYNC_BATCH_LEN && xQueueReceive(s_queue, &s_batch[count], 0) == pdTRUE)
+        {
+            count++;
+        }
+
+        /* A command is replaced by a later one of the same kind, never across a codec operation */
+        for (size_t i = 0; i < count; i++)
+        {
+            s_batch_superseded[i] = TAD5212_ASYNC_NONE;
+
+            for (size_t j = i + 1; j < count && s_batch[j].type != TAD5212_ASYNC_CALL; j++)
+            {
+                if (tad5212_async_supersedes(&s_batch[i], &s_batch[j]))
+                {
+                    s_batch_superseded[i] = j;
+                    break;
+                }
+            }
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (s_batch_superseded[i] == TAD5212_ASYNC_NONE)
+            {
+                s_batch_status[i] = tad5212_async_execute(&s_batch[i]);
+            }
+        }
+
+        /* Superseded commands complete with the status of the command that replaced them */
+        for (size_t i = 0; i < count; i++)
+        {
+            size_t last = i;
+
+            while (s_batch_superseded[last] != TAD5212_ASYNC_NONE)
+            {
+                last = s_batch_superseded[last];
+            }
+
+            if (s_batch[i].cb != NULL)
+            {
+                s_batch[i].cb(s_batch_status[last], s_batch[i].arg);
+            }
+        }
+    }
+}
+
+/*** Extern functions ***********************************************************************/
+
+/**
+ * \brief Start the worker task applying the queued commands.
+ * \param priority Priority of the worker task.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t tad5212_async_start(uint32_t priority)
+{
+    if (s_task_handle != NULL)
+    {
+        return ESP_OK;
+    }
+
+    s_queue = xQueueCreateStatic(TAD5212_ASYNC_QUEUE_LEN, sizeof(tad5212_async_cmd_t), s_queue_storage, &s_queue_buffer);
+    if (s_queue == NULL)
+    {
+        ESP_LOGE(TAD5212_ASYNC_TAG, "Command queue creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_task_handle = xTaskCreateStatic(tad5212_async_task, "CodecTask", TAD5212_ASYNC_STACK_SIZE, NULL, priority,
+                                      s_task_stack, &s_task_buffer);
+    if (s_task_handle == NULL)
+    {
+        ESP_LOGE(TAD5212_ASYNC_TAG, "Codec task creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ * \brief Queue a write of consecutive registers of a page. Never blocks. A queued write of the
+ *        same registers to the same codecs is replaced by this one.
+ * \param devices Codecs to write.
+ * \param num_devices Number of codecs.
+ * \param page Register page.
+ * \param reg First register address.
+ * \param data Register values, copied.
+ * \param len Number of registers, at most TAD5212_ASYNC_DATA_MAX.
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_NO_MEM if the queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_write(tad5212_handle_t* const* devices, size_t num_devices, uint8_t page, uint8_t reg,
+                              const uint8_t* data, size_t len, tad5212_async_cb_t cb, void* arg)
+{
+    tad5212_async_cmd_t cmd =
+    {
+        .type = TAD5212_ASYNC_WRITE,
+        .page = page,
+        .reg = reg,
+        .len = len,
+        .cb = cb,
+        .arg = arg,
+    };
+
+    if (data == NULL || len == 0 || len > TAD5212_ASYNC_DATA_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memcpy(cmd.data, data, len);
+
+    return tad5212_async_queue(&cmd, devices, num_devices);
+}
+
+
+/**
+ * \brief Queue a volume change. Never blocks. A queued volume change of the same channels of the
+ *        same codecs is replaced by this one.
+ * \param devices Codecs to set.
+ * \param num_devices Number of codecs.
+ * \param channel Channel to set volume.
+ * \param volume Volume level (0-100).
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_NO_MEM if the queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_set_volume(tad5212_handle_t* const* devices, size_t num_devices, tad5212_channel_t channel,
+                                   uint8_t volume, tad5212_async_cb_t cb, void* arg)
+{
+    tad5212_async_cmd_t cmd =
+    {
+        .type = TAD5212_ASYNC_VOLUME,
+        .channel = channel,
+        .volume = volume,
+        .cb = cb,
+        .arg = arg,
+    };
+
+    return tad5212_async_queue(&cmd, devices, num_devices);
+}
+
+
+/**
+ * \brief Queue a retuning of the crossover filters for a sample rate. Never blocks. A queued
+ *        retuning of the same codecs is replaced by this one.
+ * \param devices Codecs to retune.
+ * \param num_devices Number of codecs.
+ * \param sample_rate Sample rate of the audio stream in Hz.
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_NO_MEM if the queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_set_sample_rate(tad5212_handle_t* const* devices, size_t num_devices, uint32_t sample_rate,
+                                        tad5212_async_cb_t cb, void* arg)
+{
+    tad5212_async_cmd_t cmd =
+    {
+        .type = TAD5212_ASYNC_SAMPLE_RATE,
+        .sample_rate = sample_rate,
+        .cb = cb,
+        .arg = arg,
+    };
+
+    return tad5212_async_queue(&cmd, devices, num_devices);
+}
+
+
+/**
+ * \brief Queue a mixer matrix change, loaded in one burst. Never blocks. A queued mixer matrix
+ *        change of the same codecs is replaced by this one.
+ * \param devices Codecs to set.
+ * \param num_devices Number of codecs.
+ * \param matrix Mixer matrix, converted before being queued.
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_INVALID_ARG if a gain is out of bounds, ESP_ERR_NO_MEM if the
+ *         queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_set_mixer_matrix(tad5212_handle_t* const* devices, size_t num_devices,
+                                         const tad5212_mixer_matrix_t* matrix, tad5212_async_cb_t cb, void* arg)
+{
+    tad5212_async_cmd_t cmd =
+    {
+        .type = TAD5212_ASYNC_MIXER,
+        .cb = cb,
+        .arg = arg,
+    };
+    tad5212_mixer_coeffs_t coeffs[TAD5212_MIXER_INPUTS];
+
+    /* Out of bounds gains are reported to the caller, not to the worker */
+    esp_err_t status = tad5212_mixer_matrix_coeffs(matrix, coeffs);
+    if (status != ESP_OK)
+    {
+        return status;
+    }
+
+    memcpy(cmd.data, coeffs, sizeof(coeffs));
+
+    return tad5212_async_queue(&cmd, devices, num_devices);
+}
+
+
+/**
+ * \brief Queue a codec operation, run by the worker on each codec in turn. Never blocks.
+ * \param devices Codecs to run the operation on.
+ * \param num_devices Number of codecs.
+ * \param fn Operation.
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_NO_MEM if the queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_call(tad5212_handle_t* const* devices, size_t num_devices, tad5212_async_fn_t fn,
+                             tad5212_async_cb_t cb, void* arg)
+{
+    tad5212_async_cmd_t cmd =
+    {
+        .type = TAD5212_ASYNC_CALL,
+        .fn = fn,
+        .cb = cb,
+        .arg = arg,
+    };
+
+    if (fn == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return tad5212_async_queue(&cmd, devices, num_devices);
+}
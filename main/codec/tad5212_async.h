@@ -0,0 +1,129 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Asynchronous command queue of TAD5212 audio CODECs
+ *
+ * No licence
+ */
+
+#ifndef __TAD5212_ASYNC_H__
+#define __TAD5212_ASYNC_H__
+
+/*** Includes **************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "tad5212.h"
+
+/*** Defines **************************************************************************/
+
+/* log tag */
+#define TAD5212_ASYNC_TAG           "TAD5212_ASYNC"
+
+/* commands waiting for the worker */
+#define TAD5212_ASYNC_QUEUE_LEN     (16)
+
+/* codecs targeted by one command */
+#define TAD5212_ASYNC_DEVICES_MAX   (2)
+
+/* registers written by one command */
+#define TAD5212_ASYNC_DATA_MAX      (32)
+
+/*** Types ****************************************************************************/
+
+/**
+ * Completion callback, called from the worker task once the command was applied to every
+ * codec, or replaced by a later command of the same kind. Must not block.
+ */
+typedef void (*tad5212_async_cb_t)(esp_err_t status, void* arg);
+
+/* Codec operation run by the worker */
+typedef esp_err_t (*tad5212_async_fn_t)(tad5212_handle_t* device);
+
+/*** Extern functions *****************************************************************/
+
+/**
+ * \brief Start the worker task applying the queued commands.
+ * \param priority Priority of the worker task.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t tad5212_async_start(uint32_t priority);
+
+
+/**
+ * \brief Queue a write of consecutive registers of a page. Never blocks. A queued write of the
+ *        same registers to the same codecs is replaced by this one.
+ * \param devices Codecs to write.
+ * \param num_devices Number of codecs.
+ * \param page Register page.
+ * \param reg First register address.
+ * \param data Register values, copied.
+ * \param len Number of registers, at most TAD5212_ASYNC_DATA_MAX.
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_NO_MEM if the queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_write(tad5212_handle_t* const* devices, size_t num_devices, uint8_t page, uint8_t reg,
+                              const uint8_t* data, size_t len, tad5212_async_cb_t cb, void* arg);
+
+
+/**
+ * \brief Queue a volume change. Never blocks. A queued volume change of the same channels of the
+ *        same codecs is replaced by this one.
+ * \param devices Codecs to set.
+ * \param num_devices Number of codecs.
+ * \param channel Channel to set volume.
+ * \param volume Volume level (0-100).
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_NO_MEM if the queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_set_volume(tad5212_handle_t* const* devices, size_t num_devices, tad5212_channel_t channel,
+                                   uint8_t volume, tad5212_async_cb_t cb, void* arg);
+
+
+/**
+ * \brief Queue a retuning of the crossover filters for a sample rate. Never blocks. A queued
+ *        retuning of the same codecs is replaced by this one.
+ * \param devices Codecs to retune.
+ * \param num_devices Number of codecs.
+ * \param sample_rate Sample rate of the audio stream in Hz.
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_NO_MEM if the queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_set_sample_rate(tad5212_handle_t* const* devices, size_t num_devices, uint32_t sample_rate,
+                                        tad5212_async_cb_t cb, void* arg);
+
+
+/**
+ * \brief Queue a mixer matrix change, loaded in one burst. Never blocks. A queued mixer matrix
+ *        change of the same codecs is replaced by this one.
+ * \param devices Codecs to set.
+ * \param num_devices Number of codecs.
+ * \param matrix Mixer matrix, converted before being queued.
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_INVALID_ARG if a gain is out of bounds, ESP_ERR_NO_MEM if the
+ *         queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_set_mixer_matrix(tad5212_handle_t* const* devices, size_t num_devices,
+                                         const tad5212_mixer_matrix_t* matrix, tad5212_async_cb_t cb, void* arg);
+
+
+/**
+ * \brief Queue a codec operation, run by the worker on each codec in turn. Never blocks.
+ * \param devices Codecs to run the operation on.
+ * \param num_devices Number of codecs.
+ * \param fn Operation.
+ * \param cb Completion callback, or NULL.
+ * \param arg Argument of the completion callback.
+ * \return ESP_OK if queued, ESP_ERR_NO_MEM if the queue is full, otherwise an error code.
+ */
+esp_err_t tad5212_async_call(tad5212_handle_t* const* devices, size_t num_devices, tad5212_async_fn_t fn,
+                             tad5212_async_cb_t cb, void* arg);
+
+#endif /* __TAD5212_ASYNC_H__ */
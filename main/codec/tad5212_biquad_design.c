@@ -0,0 +1,405 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Integer-only design of TAD5212 biquad filter coefficients
+ *
+ * Intermediate values are signed Q32 fixed point in 64 bits. Coefficients are delivered in the
+ * codec format: Q1.31, with N1 and D1 halved, for
+ * y[n] = N0.x[n] + 2.N1.x[n-1] + N2.x[n-2] + 2.D1.y[n-1] + D2.y[n-2]
+ *
+ * No licence
+ */
+
+/*** Includes ***********************************************************************/
+
+#include <stdbool.h>
+
+#include "tad5212_biquad_design.h"
+
+/*** Defines ***********************************************************************/
+
+#define Q32_ONE             (1LL << 32)
+
+/* CORDIC runs in Q40, 8 guard bits keep small sines accurate */
+#define CORDIC_GUARD_BITS   8
+#define CORDIC_STEPS        40
+
+/* CORDIC gain compensation, 1 / prod(sqrt(1 + 2^-2i)) in Q40 */
+#define CORDIC_K            667681663043LL
+
+/* pi and log2(10) */
+#define PI_Q32              13493037705LL
+#define LOG2_10_Q30         3566893132LL
+
+/* Fractional bits of the exponent of exp2_q32 */
+#define EXP2_FRAC_BITS      30
+
+/*** Static variables ***********************************************************************/
+
+/* atan(2^-i) in Q40 */
+static const int64_t s_cordic_atan[CORDIC_STEPS] =
+{
+    863554413089LL, 509785937287LL, 269356888665LL, 136729762476LL, 68630207382LL, 34348560106LL,
+    17178471287LL, 8589759836LL, 4294945451LL, 2147480917LL, 1073741483LL, 536870869LL,
+    268435451LL, 134217727LL, 67108864LL, 33554432LL, 16777216LL, 8388608LL,
+    4194304LL, 2097152LL, 1048576LL, 524288LL, 262144LL, 131072LL,
+    65536LL, 32768LL, 16384LL, 8192LL, 4096LL, 2048LL,
+    1024LL, 512LL, 256LL, 128LL, 64LL, 32LL,
+    16LL, 8LL, 4LL, 2LL,
+};
+
+/* 2^(2^-k) in Q32, k = 1 .. EXP2_FRAC_BITS */
+static const int64_t s_exp2_frac[EXP2_FRAC_BITS] =
+{
+    6074001000LL, 5107605667LL, 4683695048LL, 4485121744LL, 4389014833LL, 4341736423LL, 4318288544LL, 4306612134LL,
+    4300785774LL, 4297875550LL, 4296421177LL, 4295694175LL, 4295330720LL, 4295149004LL, 4295058149LL, 4295012722LL,
+    4294990009LL, 4294978653LL, 4294972974LL, 4294970135LL, 4294968716LL, 4294968006LL, 4294967651LL, 4294967473LL,
+    4294967385LL, 4294967340LL, 4294967318LL, 4294967307LL, 4294967302LL, 4294967299LL,
+};
+
+/*** Prototypes *****************************************************************************/
+
+/**
+ * \brief Multiply two Q32 values, rounded, without intermediate overflow.
+ * \param a First operand.
+ * \param b Second operand.
+ * \return a * b in Q32.
+ */
+static int64_t mul_q32(int64_t a, int64_t b);
+
+
+/**
+ * \brief Sine and cosine of an angle by CORDIC.
+ * \param angle Angle in radians, Q32, within [0, pi/2].
+ * \param sine Pointer to store the sine, Q32.
+ * \param cosine Pointer to store the cosine, Q32.
+ */
+static void sincos_q32(int64_t angle, int64_t* sine, int64_t* cosine);
+
+
+/**
+ * \brief Power of 2.
+ * \param exponent Exponent, with EXP2_FRAC_BITS fractional bits.
+ * \return 2^exponent in Q32.
+ */
+static int64_t exp2_q32(int64_t exponent);
+
+
+/**
+ * \brief Convert a ratio of Q32 values into a codec coefficient.
+ * \param num Numerator.
+ * \param den Denominator, positive.
+ * \param coeff Pointer to store num / den in Q1.31.
+ * \return true if the ratio fits the codec format, false otherwise.
+ */
+static bool ratio_q31(int64_t num, int64_t den, uint32_t* coeff);
+
+/*** Static functions ***********************************************************************/
+
+/**
+ * \brief Multiply two Q32 values, rounded, without intermediate overflow.
+ * \param a First operand.
+ * \param b Second operand.
+ * \return a * b in Q32.
+ */
+static int64_t mul_q32(int64_t a, int64_t b)
+{
+    bool negative = (a < 0) != (b < 0);
+    uint64_t ua = (a < 0) ? (uint64_t)-a : (uint64_t)a;
+    uint64_t ub = (b < 0) ? (uint64_t)-b : (uint64_t)b;
+    uint64_t ah = ua >> 32, al = ua & 0xFFFFFFFFULL;
+    uint64_t bh = ub >> 32, bl = ub & 0xFFFFFFFFULL;
+
+    /* Product of the 32-bit halves, the low part rounded */
+    uint64_t result = ((ah * bh) << 32) + ah * bl + al * bh + ((al * bl + (1ULL << 31)) >> 32);
+
+    return negative ? -(int64_t)result : (int64_t)result;
+}
+
+
+/**
+ * \brief Sine and cosine of an angle by CORDIC.
+ * \param angle Angle in radians, Q32, within [0, pi/2].
+ * \param sine Pointer to store the sine, Q32.
+ * \param cosine Pointer to store the cosine, Q32.
+ */
+static void sincos_q32(int64_t angle, int64_t* sine, int64_t* cosine)
+{
+    int64_t x = CORDIC_K;
+    int64_t y = 0;
+    int64_t z = angle << CORDIC_GUARD_BITS;
+    int64_t x_next;
+
+    for (int i = 0; i < CORDIC_STEPS; i++)
+    {
+        /* Rotate towards the remaining angle */
+        if (z >= 0)
+        {
+            x_next = x - (y >> i);
+            y = y + (x >> i);
+            z -= s_cordic_atan[i];
+        }
+        else
+        {
+            x_next = x + (y >> i);
+            y = y - (x >> i);
+            z += s_cordic_atan[i];
+        }
+        x = x_next;
+    }
+
+    *sine = (y + (1LL << (CORDIC_GUARD_BITS - 1))) >> CORDIC_GUARD_BITS;
+    *cosine = (x + (1LL << (CORDIC_GUARD_BITS - 1))) >> CORDIC_GUARD_BITS;
+}
+
+
+/**
+ * \brief Power of 2.
+ * \param exponent Exponent, with EXP2_FRAC_BITS fractional bits.
+ * \return 2^exponent in Q32.
+ */
+static int64_t exp2_q32(int64_t exponent)
+{
+    int64_t integer = exponent >> EXP2_FRAC_BITS;          /* floor, also for negative exponents */
+    int64_t fraction = exponent - (integer << EXP2_FRAC_BITS);
+    int64_t result = Q32_ONE;
+
+    /* 2^fraction as the product of 2^(2^-k) for each bit k of the fraction */
+    for (int k = 1; k <= EXP2_FRAC_BITS; k++)
+    {
+        if (fraction & (1LL << (EXP2_FRAC_BITS - k)))
+        {
+            result = mul_q32(result, s_exp2_frac[k - 1]);
+        }
+    }
+
+    return (integer >= 0) ? (result << integer) : (result >> -integer);
+}
+
+
+/**
+ * \brief Convert a ratio of Q32 values into a codec coefficient.
+ * \param num Numerator.
+ * \param den Denominator, positive.
+ * \param coeff Pointer to store num / den in Q1.31.
+ * \return true if the ratio fits the codec format, false otherwise.
+ */
+static bool ratio_q31(int64_t num, int64_t den, uint32_t* coeff)
+{
+    int64_t magnitude = (num < 0) ? -num : num;
+    int64_t q;
+
+    /* Ratios of exactly 1 may come out a few LSB above it */
+    if (den <= 0 || magnitude > den + (den >> 28))
+    {
+        return false;
+    }
+
+    if (magnitude > den)
+    {
+        magnitude = den;
+    }
+
+    /* Keep num << 31 within 64 bits, |num| <= den */
+    while (den >= (1LL << 32))
+    {
+        den >>= 1;
+        magnitude >>= 1;
+    }
+
+    q = ((magnitude << 31) + den / 2) / den;
+
+    /* Exactly 1 (all-pass N2, for instance) is the largest code */
+    if (num >= 0)
+    {
+        *coeff = (uint32_t)((q > 0x7FFFFFFFLL) ? 0x7FFFFFFFLL : q);
+    }
+    else
+    {
+        *coeff = (uint32_t)(-q);
+    }
+
+    return true;
+}
+
+/*** Extern functions ***********************************************************************/
+
+/**
+ *  \brief Compute the coefficients of a filter (RBJ cookbook responses), without any floating point.
+ *         The numerator is scaled so that the response never exceeds 0 dB: a boost of n dB is
+ *         realized as a cut of n dB of the rest of the band, which gives the headroom it needs.
+ *  \param spec Filter specification
+ *  \param sample_rate Sample rate in Hz
+ *  \param coeffs Pointer to store the coefficients, in the codec format
+ *  \return ESP_OK on success, ESP_ERR_INVALID_ARG if the specification is out of bounds,
+ *          ESP_ERR_INVALID_SIZE if a coefficient does not fit the codec format.
+ */
+esp_err_t tad5212_biquad_design(const tad5212_biquad_spec_t* spec, uint32_t sample_rate, tad5212_biquad_coeffs_t* coeffs)
+{
+    int64_t sh, ch, sine, cosine, alpha;
+    int64_t a, inv_a, sqrt_a, ap1, am1;
+    int64_t b0, b1, b2, a0, a1, a2;
+    bool boost;
+
+    if (spec == NULL || coeffs == NULL || sample_rate == 0)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (spec->freq_hz == 0 || spec->freq_hz >= sample_rate / 2 ||
+        spec->q < TAD5212_BIQUAD_Q_MIN || spec->q > TAD5212_BIQUAD_Q_MAX ||
+        spec->gain < -TAD5212_BIQUAD_GAIN_MAX || spec->gain > TAD5212_BIQUAD_GAIN_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Half of w = 2.pi.f / fs lies within [0, pi/2], the half-angle identities keep full
+     * precision on 1 - cos(w) at low frequencies */
+    sincos_q32((PI_Q32 * spec->freq_hz) / sample_rate, &sh, &ch);
+    sine = 2 * mul_q32(sh, ch);
+    cosine = Q32_ONE - 2 * mul_q32(sh, sh);
+    alpha = (sine * 1000) / (2 * (int64_t)spec->q);
+
+    /* A = 10^(gain / 40), gain in tenths of dB */
+    a = exp2_q32((spec->gain * LOG2_10_Q30) / 400);
+    inv_a = exp2_q32(-(spec->gain * LOG2_10_Q30) / 400);
+    sqrt_a = exp2_q32((spec->gain * LOG2_10_Q30) / 800);
+    ap1 = a + Q32_ONE;
+    am1 = a - Q32_ONE;
+    boost = (spec->gain > 0);
+
+    switch (spec->type)
+    {
+        case TAD5212_BIQUAD_TYPE_LOWPASS:
+            b0 = mul_q32(sh, sh);                   /* (1 - cos) / 2 */
+            b1 = 2 * b0;
+            b2 = b0;
+            a0 = Q32_ONE + alpha;
+            a1 = -2 * cosine;
+            a2 = Q32_ONE - alpha;
+            break;
+
+        case TAD5212_BIQUAD_TYPE_HIGHPASS:
+            b0 = mul_q32(ch, ch);                   /* (1 + cos) / 2 */
+            b1 = -2 * b0;
+            b2 = b0;
+            a0 = Q32_ONE + alpha;
+            a1 = -2 * cosine;
+            a2 = Q32_ONE - alpha;
+            break;
+
+        case TAD5212_BIQUAD_TYPE_PEAKING:
+            b0 = Q32_ONE + mul_q32(alpha, a);
+            b1 = -2 * cosine;
+            b2 = Q32_ONE - mul_q32(alpha, a);
+            a0 = Q32_ONE + mul_q32(alpha, inv_a);
+            a1 = -2 * cosine;
+            a2 = Q32_ONE - mul_q32(alpha, inv_a);
+
+            /* Peak of a boost (A^2) brought down to 0 dB */
+            if (boost)
+            {
+                b0 = mul_q32(mul_q32(b0, inv_a), inv_a);
+                b1 = mul_q32(mul_q32(b1, inv_a), inv_a);
+                b2 = mul_q32(mul_q32(b2, inv_a), inv_a);
+            }
+            break;
+
+        case TAD5212_BIQUAD_TYPE_LOW_SHELF:
+            b0 = ap1 - mul_q32(am1, cosine) + 2 * mul_q32(sqrt_a, alpha);
+            b1 = 2 * (am1 - mul_q32(ap1, cosine));
+            b2 = ap1 - mul_q32(am1, cosine) - 2 * mul_q32(sqrt_a, alpha);
+            a0 = ap1 + mul_q32(am1, cosine) + 2 * mul_q32(sqrt_a, alpha);
+            a1 = -2 * (am1 + mul_q32(ap1, cosine));
+            a2 = ap1 + mul_q32(am1, cosine) - 2 * mul_q32(sqrt_a, alpha);
+
+            /* The A factor of the numerator becomes 1/A for a boost: shelf (A^2) brought down
+             * to 0 dB, Nyquist at -gain */
+            if (boost)
+            {
+                b0 = mul_q32(b0, inv_a);
+                b1 = mul_q32(b1, inv_a);
+                b2 = mul_q32(b2, inv_a);
+            }
+            else
+            {
+                b0 = mul_q32(b0, a);
+                b1 = mul_q32(b1, a);
+                b2 = mul_q32(b2, a);
+            }
+            break;
+
+        case TAD5212_BIQUAD_TYPE_HIGH_SHELF:
+            b0 = ap1 + mul_q32(am1, cosine) + 2 * mul_q32(sqrt_a, alpha);
+            b1 = -2 * (am1 + mul_q32(ap1, cosine));
+            b2 = ap1 + mul_q32(am1, cosine) - 2 * mul_q32(sqrt_a, alpha);
+            a0 = ap1 - mul_q32(am1, cosine) + 2 * mul_q32(sqrt_a, alpha);
+            a1 = 2 * (am1 - mul_q32(ap1, cosine));
+            a2 = ap1 - mul_q32(am1, cosine) - 2 * mul_q32(sqrt_a, alpha);
+
+            /* The A factor of the numerator becomes 1/A for a boost: shelf (A^2) brought down
+             * to 0 dB, DC at -gain */
+            if (boost)
+            {
+                b0 = mul_q32(b0, inv_a);
+                b1 = mul_q32(b1, inv_a);
+                b2 = mul_q32(b2, inv_a);
+            }
+            else
+            {
+                b0 = mul_q32(b0, a);
+                b1 = mul_q32(b1, a);
+                b2 = mul_q32(b2, a);
+            }
+            break;
+
+        case TAD5212_BIQUAD_TYPE_NOTCH:
+            b0 = Q32_ONE;
+            b1 = -2 * cosine;
+            b2 = Q32_ONE;
+            a0 = Q32_ONE + alpha;
+            a1 = -2 * cosine;
+            a2 = Q32_ONE - alpha;
+            break;
+
+        case TAD5212_BIQUAD_TYPE_ALLPASS:
+            b0 = Q32_ONE - alpha;
+            b1 = -2 * cosine;
+            b2 = Q32_ONE + alpha;
+            a0 = Q32_ONE + alpha;
+            a1 = -2 * cosine;
+            a2 = Q32_ONE - alpha;
+            break;
+
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Normalize by a0, N1 and D1 halved, denominator signs of the codec */
+    if (!ratio_q31(b0, a0, &coeffs->n0.value) ||
+        !ratio_q31(b1, 2 * a0, &coeffs->n1.value) ||
+        !ratio_q31(b2, a0, &coeffs->n2.value) ||
+        !ratio_q31(-a1, 2 * a0, &coeffs->d1.value) ||
+        !ratio_q31(-a2, a0, &coeffs->d2.value))
+    {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ *  \brief Linear amplitude of a gain, without any floating point.
+ *  \param gain Gain in tenths of dB, within [-TAD5212_DB_GAIN_MAX, TAD5212_DB_GAIN_MAX].
+ *  \return 10^(gain / 200) in Q32, 0 if the gain is out of bounds.
+ */
+int64_t tad5212_db_to_gain_q32(int32_t gain)
+{
+    if (gain < -TAD5212_DB_GAIN_MAX || gain > TAD5212_DB_GAIN_MAX)
+    {
+        return 0;
+    }
+
+    return exp2_q32((gain * LOG2_10_Q30) / 200);
+}
@@ -0,0 +1,82 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Integer-only design of TAD5212 biquad filter coefficients
+ *
+ * No licence
+ */
+
+#ifndef __TAD5212_BIQUAD_DESIGN_H__
+#define __TAD5212_BIQUAD_DESIGN_H__
+
+/*** Includes **************************************************************************/
+
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#include "tad5212_biquad_filters.h"
+
+/*** Defines **************************************************************************/
+
+/* Butterworth quality factor, in thousandths */
+#define TAD5212_BIQUAD_Q_BUTTERWORTH    707
+
+/* Bounds of the design parameters */
+#define TAD5212_BIQUAD_Q_MIN            100         /* 0.1 */
+#define TAD5212_BIQUAD_Q_MAX            20000       /* 20 */
+#define TAD5212_BIQUAD_GAIN_MAX         240         /* 24 dB, in tenths of dB */
+
+/* Bound of tad5212_db_to_gain_q32(), in tenths of dB */
+#define TAD5212_DB_GAIN_MAX             1200        /* 120 dB */
+
+/*** Enumerations *********************************************************************/
+
+/* Filter responses */
+typedef enum
+{
+    TAD5212_BIQUAD_TYPE_LOWPASS = 0,
+    TAD5212_BIQUAD_TYPE_HIGHPASS,
+    TAD5212_BIQUAD_TYPE_PEAKING,
+    TAD5212_BIQUAD_TYPE_LOW_SHELF,
+    TAD5212_BIQUAD_TYPE_HIGH_SHELF,
+    TAD5212_BIQUAD_TYPE_NOTCH,
+    TAD5212_BIQUAD_TYPE_ALLPASS,
+}
+tad5212_biquad_type_t;
+
+/*** Structures ***********************************************************************/
+
+/* Filter specification */
+typedef struct
+{
+    tad5212_biquad_type_t   type;       /* Filter response */
+    uint32_t                freq_hz;    /* Corner or center frequency */
+    uint32_t                q;          /* Quality factor, in thousandths */
+    int32_t                 gain;       /* Peaking and shelf gain, in tenths of dB */
+}
+tad5212_biquad_spec_t;
+
+/*** Extern functions *****************************************************************/
+
+/**
+ *  \brief Compute the coefficients of a filter (RBJ cookbook responses), without any floating point.
+ *         The numerator is scaled so that the response never exceeds 0 dB: a boost of n dB is
+ *         realized as a cut of n dB of the rest of the band, which gives the headroom it needs.
+ *  \param spec Filter specification
+ *  \param sample_rate Sample rate in Hz
+ *  \param coeffs Pointer to store the coefficients, in the codec format
+ *  \return ESP_OK on success, ESP_ERR_INVALID_ARG if the specification is out of bounds,
+ *          ESP_ERR_INVALID_SIZE if a coefficient does not fit the codec format.
+ */
+esp_err_t tad5212_biquad_design(const tad5212_biquad_spec_t* spec, uint32_t sample_rate, tad5212_biquad_coeffs_t* coeffs);
+
+
+/**
+ *  \brief Linear amplitude of a gain, without any floating point.
+ *  \param gain Gain in tenths of dB, within [-TAD5212_DB_GAIN_MAX, TAD5212_DB_GAIN_MAX].
+ *  \return 10^(gain / 200) in Q32, 0 if the gain is out of bounds.
+ */
+int64_t tad5212_db_to_gain_q32(int32_t gain);
+
+#endif /* __TAD5212_BIQUAD_DESIGN_H__ */
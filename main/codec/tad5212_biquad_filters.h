@@ -61,6 +61,16 @@ tad5212_biquad_coeffs_t;
 
 /*** Filters ******************************************************************/
 
+/* Reset value of the filters, also loaded when a filter cannot be realized at a sample rate */
+const static tad5212_biquad_coeffs_t TAD5212_BIQUAD_PASS_THROUGH =
+{
+    .n0 = { .value = 0x7FFFFFFF },
+    .n1 = { .value = 0x00000000 },
+    .n2 = { .value = 0x00000000 },
+    .d1 = { .value = 0x00000000 },
+    .d2 = { .value = 0x00000000 },
+};
+
 const static tad5212_biquad_coeffs_t TAD5212_BIQUAD_LOWPASS_150_HZ =
 {
     .n0 = { .value = 0x0003B0BC },
@@ -13,6 +13,10 @@
 #include <stdbool.h>
 #include <stdio.h>
 
+#include "sdkconfig.h"
+
+#include "tad5212_biquad_design.h"
+
 /*** Defines ***********************************************************************/
 
 /* Minimum DAC volume (-60dB) */
@@ -24,4 +28,70 @@
 /* Volume step */
 #define TAD5212_DAC_VOLUME_STEP         ((TAD5212_DAC_MAX_VOLUME - TAD5212_DAC_MIN_VOLUME) / 100.0)
 
+/* Group delay of the DAC interpolation filters, in samples at the audio rate. The Kconfig defaults
+ * are estimates, neither datasheet values nor measurements: set them for the board (see Kconfig) */
+#define TAD5212_DAC_DELAY_LINEAR_PHASE  CONFIG_TAD5212_DAC_DELAY_LINEAR_PHASE
+#define TAD5212_DAC_DELAY_LOW_LATENCY   CONFIG_TAD5212_DAC_DELAY_LOW_LATENCY
+#define TAD5212_DAC_DELAY_ULTRA_LOW     CONFIG_TAD5212_DAC_DELAY_ULTRA_LOW
+
+/*** Enumerations ********************************************************************/
+
+/* Initialization step types */
+typedef enum
+{
+    TAD5212_STEP_END = 0,       /* End of the sequence */
+    TAD5212_STEP_REGISTER,      /* Consecutive 1 byte registers of a page */
+    TAD5212_STEP_BIQUAD,        /* Biquad filter coefficients */
+    TAD5212_STEP_MIXER,         /* Mixer row coefficients */
+}
+tad5212_step_type_t;
+
+/*** Structures ********************************************************************/
+
+/* Initialization step, contiguous register steps are merged into bursts */
+typedef struct
+{
+    uint8_t     type;           /* Step type (tad5212_step_type_t) */
+    uint8_t     page;           /* Register page */
+    uint8_t     reg;            /* First register, biquad filter or mixer row */
+    uint8_t     len;            /* Payload length in bytes */
+    uint16_t    delay_ms;       /* Delay after the step */
+    const void* payload;        /* Register values or coefficients */
+}
+tad5212_init_step_t;
+
+/* Crossover filter, designed for each supported sample rate */
+typedef struct
+{
+    uint8_t                 filter;     /* Biquad filter (tad5212_biquad_filter_t), 0 ends the list */
+    tad5212_biquad_spec_t   spec;       /* Filter response */
+}
+tad5212_crossover_t;
+
+/*** Macros ************************************************************************/
+
+/* Write a register configuration, then wait delay_ms */
+#define TAD5212_STEP_REG(page_, reg_, cfg_, delay_ms_) \
+    { TAD5212_STEP_REGISTER, (page_), (reg_), sizeof((cfg_).data), (delay_ms_), &(cfg_).data }
+
+/* Load biquad filter coefficients */
+#define TAD5212_STEP_BQ(filter_, coeffs_) \
+    { TAD5212_STEP_BIQUAD, 0, (filter_), sizeof(coeffs_), 0, &(coeffs_) }
+
+/* Load mixer row coefficients */
+#define TAD5212_STEP_MIX(mixer_, coeffs_) \
+    { TAD5212_STEP_MIXER, 0, (mixer_), sizeof(coeffs_), 0, &(coeffs_) }
+
+/* End of sequence */
+#define TAD5212_STEP_LAST \
+    { TAD5212_STEP_END, 0, 0, 0, 0, NULL }
+
+/* Butterworth crossover filter */
+#define TAD5212_CROSSOVER(filter_, type_, freq_hz_) \
+    { (filter_), { (type_), (freq_hz_), TAD5212_BIQUAD_Q_BUTTERWORTH, 0 } }
+
+/* End of crossover filters */
+#define TAD5212_CROSSOVER_LAST \
+    { 0, { 0, 0, 0, 0 } }
+
 #endif /* __TAD5212_DEFINES_H__ */
\ No newline at end of file
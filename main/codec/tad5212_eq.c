@@ -0,0 +1,439 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Parametric equalizer of TAD5212 audio CODECs, run on the biquads left free by the crossover
+ *
+ * No licence
+ */
+
+/*** Includes ***********************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "nvs.h"
+#include "sys/lock.h"
+
+#include "tad5212_eq.h"
+#include "tad5212_async.h"
+
+/*** Defines ***********************************************************************/
+
+/* NVS storage */
+#define TAD5212_EQ_NVS_NAMESPACE    "tad5212_eq"
+#define TAD5212_EQ_NVS_SELECTED     "selected"
+#define TAD5212_EQ_NVS_KEY_LEN      16
+
+/* biquad stages of a DAC channel */
+#define TAD5212_EQ_STAGES           3
+
+/* DAC channels equalized */
+#define TAD5212_EQ_CHANNELS         2
+
+/* filters are numbered stage by stage, 4 DAC channels per stage */
+#define TAD5212_EQ_FILTER(stage_, channel_)     ((tad5212_biquad_filter_t)((stage_) * 4 + (channel_) + 1))
+#define TAD5212_EQ_FILTER_STAGE(filter_)        (((filter_) - 1) / 4)
+
+/*** Static variables ***********************************************************************/
+
+/* Built-in profiles, until replaced in NVS */
+static const tad5212_eq_profile_t s_default_profiles[TAD5212_EQ_PROFILES] =
+{
+    { .name = "Flat",   .num_bands = 0 },
+    { .name = "Bass",   .num_bands = 1, .bands = { { TAD5212_BIQUAD_TYPE_LOW_SHELF,  120,  TAD5212_BIQUAD_Q_BUTTERWORTH, 60 } } },
+    { .name = "Vocal",  .num_bands = 1, .bands = { { TAD5212_BIQUAD_TYPE_PEAKING,    2500, 1000,                         30 } } },
+    { .name = "Treble", .num_bands = 1, .bands = { { TAD5212_BIQUAD_TYPE_HIGH_SHELF, 6000, TAD5212_BIQUAD_Q_BUTTERWORTH, 40 } } },
+};
+
+/* Sample rates every band must be realizable at */
+static const uint32_t s_sample_rates[TAD5212_SAMPLE_RATE_COUNT] = TAD5212_SAMPLE_RATES;
+
+/* read by the command queue worker */
+static _lock_t s_lock;
+static tad5212_eq_profile_t s_profiles[TAD5212_EQ_PROFILES];
+static uint8_t s_selected = 0;
+
+/*** Prototypes *****************************************************************************/
+
+/**
+ * \brief Get the NVS key of a profile.
+ * \param index Profile index.
+ * \param key Buffer of TAD5212_EQ_NVS_KEY_LEN characters.
+ */
+static void tad5212_eq_key(uint8_t index, char* key);
+
+
+/**
+ * \brief Check that every band of a profile can be designed at every supported sample rate.
+ * \param profile Profile.
+ * \return ESP_OK if valid, otherwise the design error.
+ */
+static esp_err_t tad5212_eq_check(const tad5212_eq_profile_t* profile);
+
+
+/**
+ * \brief Get the biquad stages of a codec not used by its crossover.
+ * \param device TAD5212 device.
+ * \param stages Buffer of TAD5212_EQ_STAGES stages.
+ * \return Number of free stages.
+ */
+static size_t tad5212_eq_free_stages(const tad5212_handle_t* device, uint8_t* stages);
+
+/*** Static functions ***********************************************************************/
+
+/**
+ * \brief Get the NVS key of a profile.
+ * \param index Profile index.
+ * \param key Buffer of TAD5212_EQ_NVS_KEY_LEN characters.
+ */
+static void tad5212_eq_key(uint8_t index, char* key)
+{
+    snprintf(key, TAD5212_EQ_NVS_KEY_LEN, "profile%u", (unsigned)index);
+}
+
+
+/**
+ * \brief Check that every band of a profile can be designed at every supported sample rate.
+ * \param profile Profile.
+ * \return ESP_OK if valid, otherwise the design error.
+ */
+static esp_err_t tad5212_eq_check(const tad5212_eq_profile_t* profile)
+{
+    esp_err_t status;
+    tad5212_biquad_coeffs_t coeffs;
+
+    if (profile->num_bands > TAD5212_EQ_BANDS_MAX || memchr(profile->name, '\0', TAD5212_EQ_NAME_LEN) == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (uint8_t i = 0; i < profile->num_bands; i++)
+    {
+        for (size_t j = 0; j < TAD5212_SAMPLE_RATE_COUNT; j++)
+        {
+            status = tad5212_biquad_design(&profile->bands[i], s_sample_rates[j], &coeffs);
+            if (status != ESP_OK)
+            {
+                return status;
+            }
+        }
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ * \brief Get the biquad stages of a codec not used by its crossover.
+ * \param device TAD5212 device.
+ * \param stages Buffer of TAD5212_EQ_STAGES stages.
+ * \return Number of free stages.
+ */
+static size_t tad5212_eq_free_stages(const tad5212_handle_t* device, uint8_t* stages)
+{
+    size_t count = 0;
+    bool used;
+
+    for (uint8_t stage = 0; stage < TAD5212_EQ_STAGES; stage++)
+    {
+        used = false;
+
+        for (uint8_t i = 0; i < device->crossover_len; i++)
+        {
+            if (TAD5212_EQ_FILTER_STAGE(device->crossover_filter[i]) == stage)
+            {
+                used = true;
+                break;
+            }
+        }
+
+        if (!used)
+        {
+            stages[count++] = stage;
+        }
+    }
+
+    return count;
+}
+
+/*** Extern functions ***********************************************************************/
+
+/**
+ * \brief Load the profiles and the selected profile from NVS, built-in profiles are used for the
+ *        ones never stored.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t tad5212_eq_init(void)
+{
+    nvs_handle_t nvs;
+    char key[TAD5212_EQ_NVS_KEY_LEN];
+    size_t size;
+    uint8_t selected = 0;
+    esp_err_t status;
+
+    _lock_init(&s_lock);
+    memcpy(s_profiles, s_default_profiles, sizeof(s_profiles));
+    s_selected = 0;
+
+    /* Built-in profiles go through the same trial design as the stored ones */
+    for (uint8_t i = 0; i < TAD5212_EQ_PROFILES; i++)
+    {
+        status = tad5212_eq_check(&s_profiles[i]);
+        if (status != ESP_OK)
+        {
+            ESP_LOGE(TAD5212_EQ_TAG, "Built-in profile %u (%s) not realizable: %s, flat used",
+                     (unsigned)i, s_profiles[i].name, esp_err_to_name(status));
+            s_profiles[i].num_bands = 0;
+        }
+    }
+
+    status = nvs_open(TAD5212_EQ_NVS_NAMESPACE, NVS_READONLY, &nvs);
+
+    /* Nothing stored yet */
+    if (status == ESP_ERR_NVS_NOT_FOUND)
+    {
+        return ESP_OK;
+    }
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_EQ_TAG, "NVS open failed: %s", esp_err_to_name(status));
+        return status;
+    }
+
+    for (uint8_t i = 0; i < TAD5212_EQ_PROFILES; i++)
+    {
+        tad5212_eq_profile_t profile;
+
+        tad5212_eq_key(i, key);
+        size = sizeof(profile);
+
+        if (nvs_get_blob(nvs, key, &profile, &size) != ESP_OK)
+        {
+            continue;
+        }
+
+        /* Stored by another layout, or out of bounds: keep the built-in profile */
+        if (size != sizeof(profile) || tad5212_eq_check(&profile) != ESP_OK)
+        {
+            ESP_LOGW(TAD5212_EQ_TAG, "Stored profile %u invalid, built-in one used", (unsigned)i);
+            continue;
+        }
+
+        s_profiles[i] = profile;
+    }
+
+    if (nvs_get_u8(nvs, TAD5212_EQ_NVS_SELECTED, &selected) == ESP_OK && selected < TAD5212_EQ_PROFILES)
+    {
+        s_selected = selected;
+    }
+
+    nvs_close(nvs);
+
+    ESP_LOGI(TAD5212_EQ_TAG, "Profile %u (%s) selected", (unsigned)s_selected, s_profiles[s_selected].name);
+
+    return ESP_OK;
+}
+
+
+/**
+ * \brief Get a profile.
+ * \param index Profile index, below TAD5212_EQ_PROFILES.
+ * \param profile Pointer to store the profile.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t tad5212_eq_get_profile(uint8_t index, tad5212_eq_profile_t* profile)
+{
+    if (index >= TAD5212_EQ_PROFILES || profile == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    _lock_acquire(&s_lock);
+    *profile = s_profiles[index];
+    _lock_release(&s_lock);
+
+    return ESP_OK;
+}
+
+
+/**
+ * \brief Replace a profile and store it in NVS. The codecs are not reloaded, select the profile
+ *        again to apply it.
+ * \param index Profile index, below TAD5212_EQ_PROFILES.
+ * \param profile New profile, every band must be realizable at every supported sample rate.
+ * \return ESP_OK if successful, ESP_ERR_INVALID_ARG if a band is out of bounds, otherwise an error code.
+ */
+esp_err_t tad5212_eq_set_profile(uint8_t index, const tad5212_eq_profile_t* profile)
+{
+    nvs_handle_t nvs;
+    char key[TAD5212_EQ_NVS_KEY_LEN];
+    esp_err_t status;
+
+    if (index >= TAD5212_EQ_PROFILES || profile == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Never store a profile the codecs could not load */
+    status = tad5212_eq_check(profile);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_EQ_TAG, "Profile %u rejected: %s", (unsigned)index, esp_err_to_name(status));
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    _lock_acquire(&s_lock);
+    s_profiles[index] = *profile;
+    _lock_release(&s_lock);
+
+    status = nvs_open(TAD5212_EQ_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_EQ_TAG, "NVS open failed: %s", esp_err_to_name(status));
+        return status;
+    }
+
+    tad5212_eq_key(index, key);
+    status = nvs_set_blob(nvs, key, profile, sizeof(*profile));
+    if (status == ESP_OK)
+    {
+        status = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+
+    if (status != ESP_OK)
+    {
+        ESP_LOGE(TAD5212_EQ_TAG, "Profile %u not stored: %s", (unsigned)index, esp_err_to_name(status));
+        return status;
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ * \brief Select the profile applied to the codecs, store the choice in NVS and queue the reload
+ *        of the codecs. Never blocks on the codecs.
+ * \param devices Codecs to reload.
+ * \param num_devices Number of codecs.
+ * \param index Profile index, below TAD5212_EQ_PROFILES.
+ * \return ESP_OK if the reload is queued, otherwise an error code.
+ */
+esp_err_t tad5212_eq_select(tad5212_handle_t* const* devices, size_t num_devices, uint8_t index)
+{
+    nvs_handle_t nvs;
+    esp_err_t status;
+
+    if (index >= TAD5212_EQ_PROFILES)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    _lock_acquire(&s_lock);
+    s_selected = index;
+    _lock_release(&s_lock);
+
+    /* The choice survives a reboot, the codecs are reloaded even if it could not be stored */
+    status = nvs_open(TAD5212_EQ_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+    if (status == ESP_OK)
+    {
+        status = nvs_set_u8(nvs, TAD5212_EQ_NVS_SELECTED, index);
+        if (status == ESP_OK)
+        {
+            status = nvs_commit(nvs);
+        }
+        nvs_close(nvs);
+    }
+
+    if (status != ESP_OK)
+    {
+        ESP_LOGW(TAD5212_EQ_TAG, "Selected profile not stored: %s", esp_err_to_name(status));
+    }
+
+    return tad5212_async_call(devices, num_devices, tad5212_eq_load, NULL, NULL);
+}
+
+
+/**
+ * \brief Get the selected profile.
+ * \return Profile index.
+ */
+uint8_t tad5212_eq_get_selected(void)
+{
+    uint8_t selected;
+
+    _lock_acquire(&s_lock);
+    selected = s_selected;
+    _lock_release(&s_lock);
+
+    return selected;
+}
+
+
+/**
+ * \brief Load the selected profile in the biquads left free by the crossover, designed for the
+ *        sample rate the codec is tuned for. Bands beyond the free biquads are dropped.
+ *        Codec operation, run by the command queue worker.
+ * \param device TAD5212 device.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t tad5212_eq_load(tad5212_handle_t* device)
+{
+    esp_err_t status;
+    tad5212_eq_profile_t profile;
+    uint8_t stages[TAD5212_EQ_STAGES];
+    size_t num_stages;
+    tad5212_biquad_filter_t filters[TAD5212_EQ_STAGES * TAD5212_EQ_CHANNELS];
+    tad5212_biquad_coeffs_t coeffs[TAD5212_EQ_STAGES * TAD5212_EQ_CHANNELS];
+    tad5212_biquad_coeffs_t band;
+    size_t count = 0;
+
+    if (device == NULL || device->initialized == false)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    _lock_acquire(&s_lock);
+    profile = s_profiles[s_selected];
+    _lock_release(&s_lock);
+
+    num_stages = tad5212_eq_free_stages(device, stages);
+
+    if (profile.num_bands > num_stages)
+    {
+        ESP_LOGW(TAD5212_EQ_TAG, "0x%02x: %u of the %u bands of %s loaded, no free biquad left", device->addr,
+                 (unsigned)num_stages, (unsigned)profile.num_bands, profile.name);
+    }
+
+    /* Free stages beyond the profile are reset, so a previous profile leaves nothing behind */
+    for (size_t i = 0; i < num_stages; i++)
+    {
+        band = TAD5212_BIQUAD_PASS_THROUGH;
+
+        if (i < profile.num_bands)
+        {
+            status = tad5212_biquad_design(&profile.bands[i], device->sample_rate, &band);
+            if (status != ESP_OK)
+            {
+                ESP_LOGE(TAD5212_EQ_TAG, "Band %u of %s: %s", (unsigned)i, profile.name, esp_err_to_name(status));
+                return status;
+            }
+        }
+
+        for (uint8_t channel = 0; channel < TAD5212_EQ_CHANNELS; channel++)
+        {
+            filters[count] = TAD5212_EQ_FILTER(stages[i], channel);
+            coeffs[count] = band;
+            count++;
+        }
+    }
+
+    if (count == 0)
+    {
+        return ESP_OK;
+    }
+
+    /* Every band in one call, unchanged filters skipped */
+    return tad5212_set_biquads(device, filters, coeffs, count);
+}
@@ -0,0 +1,103 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Parametric equalizer of TAD5212 audio CODECs, run on the biquads left free by the crossover
+ *
+ * No licence
+ */
+
+#ifndef __TAD5212_EQ_H__
+#define __TAD5212_EQ_H__
+
+/*** Includes **************************************************************************/
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#include "tad5212.h"
+#include "tad5212_biquad_design.h"
+
+/*** Defines **************************************************************************/
+
+/* log tag */
+#define TAD5212_EQ_TAG              "TAD5212_EQ"
+
+/* bands of a profile, one biquad of each DAC channel per band */
+#define TAD5212_EQ_BANDS_MAX        (3)
+
+/* profiles stored in NVS */
+#define TAD5212_EQ_PROFILES         (4)
+
+/* profile name length, terminator included */
+#define TAD5212_EQ_NAME_LEN         (16)
+
+/*** Structures ***********************************************************************/
+
+/* EQ profile, applied to both DAC channels */
+typedef struct
+{
+    char                    name[TAD5212_EQ_NAME_LEN];      /* Profile name */
+    uint8_t                 num_bands;                      /* Bands in use */
+    tad5212_biquad_spec_t   bands[TAD5212_EQ_BANDS_MAX];    /* Band responses */
+}
+tad5212_eq_profile_t;
+
+/*** Extern functions *****************************************************************/
+
+/**
+ * \brief Load the profiles and the selected profile from NVS, built-in profiles are used for the
+ *        ones never stored.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t tad5212_eq_init(void);
+
+
+/**
+ * \brief Get a profile.
+ * \param index Profile index, below TAD5212_EQ_PROFILES.
+ * \param profile Pointer to store the profile.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t tad5212_eq_get_profile(uint8_t index, tad5212_eq_profile_t* profile);
+
+
+/**
+ * \brief Replace a profile and store it in NVS. The codecs are not reloaded, select the profile
+ *        again to apply it.
+ * \param index Profile index, below TAD5212_EQ_PROFILES.
+ * \param profile New profile, every band must be realizable at every supported sample rate.
+ * \return ESP_OK if successful, ESP_ERR_INVALID_ARG if a band is out of bounds, otherwise an error code.
+ */
+esp_err_t tad5212_eq_set_profile(uint8_t index, const tad5212_eq_profile_t* profile);
+
+
+/**
+ * \brief Select the profile applied to the codecs, store the choice in NVS and queue the reload
+ *        of the codecs. Never blocks on the codecs.
+ * \param devices Codecs to reload.
+ * \param num_devices Number of codecs.
+ * \param index Profile index, below TAD5212_EQ_PROFILES.
+ * \return ESP_OK if the reload is queued, otherwise an error code.
+ */
+esp_err_t tad5212_eq_select(tad5212_handle_t* const* devices, size_t num_devices, uint8_t index);
+
+
+/**
+ * \brief Get the selected profile.
+ * \return Profile index.
+ */
+uint8_t tad5212_eq_get_selected(void);
+
+
+/**
+ * \brief Load the selected profile in the biquads left free by the crossover, designed for the
+ *        sample rate the codec is tuned for. Bands beyond the free biquads are dropped.
+ *        Codec operation, run by the command queue worker.
+ * \param device TAD5212 device.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t tad5212_eq_load(tad5212_handle_t* device);
+
+#endif /* __TAD5212_EQ_H__ */
@@ -0,0 +1,216 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * ASI DIN mixer matrix of TAD5212 audio CODECs: gains in dB and presets
+ *
+ * Coefficients are Q1.14: 0x4000 is unity gain, 0x2000 is one half.
+ *
+ * No licence
+ */
+
+/*** Includes ***********************************************************************/
+
+#include "tad5212_mixer_matrix.h"
+#include "tad5212_biquad_design.h"
+
+/*** Defines ***********************************************************************/
+
+/* Fractional bits of a coefficient, 1 << TAD5212_MIXER_FRAC_BITS is unity gain */
+#define TAD5212_MIXER_FRAC_BITS     14
+
+/* Gain of a downmix path, just below one half so that L + R never clips */
+#define TAD5212_MIXER_GAIN_HALF     (-61)
+
+/*** Prototypes *****************************************************************************/
+
+/**
+ *  \brief Convert a path gain to a coefficient.
+ *  \param gain Path gain.
+ *  \param value Pointer to store the coefficient.
+ *  \return ESP_OK on success, ESP_ERR_INVALID_ARG if the gain is out of bounds.
+ */
+static esp_err_t tad5212_mixer_gain_to_coeff(const tad5212_mixer_gain_t* gain, uint16_t* value);
+
+/*** Static functions ***********************************************************************/
+
+/**
+ *  \brief Convert a path gain to a coefficient.
+ *  \param gain Path gain.
+ *  \param value Pointer to store the coefficient.
+ *  \return ESP_OK on success, ESP_ERR_INVALID_ARG if the gain is out of bounds.
+ */
+static esp_err_t tad5212_mixer_gain_to_coeff(const tad5212_mixer_gain_t* gain, uint16_t* value)
+{
+    int32_t coeff;
+
+    if (gain->gain == TAD5212_MIXER_GAIN_MUTE)
+    {
+        *value = 0;
+        return ESP_OK;
+    }
+
+    if (gain->gain < TAD5212_MIXER_GAIN_MIN || gain->gain > TAD5212_MIXER_GAIN_MAX)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* Q32 linear gain to Q1.14, rounded */
+    coeff = (int32_t)((tad5212_db_to_gain_q32(gain->gain) + (1LL << (31 - TAD5212_MIXER_FRAC_BITS)))
+                      >> (32 - TAD5212_MIXER_FRAC_BITS));
+
+    if (gain->invert)
+    {
+        coeff = -coeff;
+    }
+
+    *value = (uint16_t)(int16_t)coeff;
+
+    return ESP_OK;
+}
+
+/*** Extern functions ***********************************************************************/
+
+/**
+ *  \brief Build the matrix of a preset, unused paths are cut.
+ *  \param preset Preset.
+ *  \param matrix Pointer to store the matrix.
+ *  \return ESP_OK on success, ESP_ERR_INVALID_ARG if the preset is unknown.
+ */
+esp_err_t tad5212_mixer_matrix_preset(tad5212_mixer_preset_t preset, tad5212_mixer_matrix_t* matrix)
+{
+    if (matrix == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int in = 0; in < TAD5212_MIXER_INPUTS; in++)
+    {
+        for (int out = 0; out < TAD5212_MIXER_OUTPUTS; out++)
+        {
+            matrix->path[in][out].gain = TAD5212_MIXER_GAIN_MUTE;
+            matrix->path[in][out].invert = false;
+        }
+    }
+
+    switch (preset)
+    {
+        case TAD5212_MIXER_PRESET_STEREO:
+            matrix->path[TAD5212_MIXER_IN_ASI_CH1][TAD5212_MIXER_OUT_LDAC].gain = 0;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH2][TAD5212_MIXER_OUT_RDAC].gain = 0;
+            break;
+
+        case TAD5212_MIXER_PRESET_SWAP:
+            matrix->path[TAD5212_MIXER_IN_ASI_CH1][TAD5212_MIXER_OUT_RDAC].gain = 0;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH2][TAD5212_MIXER_OUT_LDAC].gain = 0;
+            break;
+
+        case TAD5212_MIXER_PRESET_MONO:
+            matrix->path[TAD5212_MIXER_IN_ASI_CH1][TAD5212_MIXER_OUT_LDAC].gain = TAD5212_MIXER_GAIN_HALF;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH2][TAD5212_MIXER_OUT_LDAC].gain = TAD5212_MIXER_GAIN_HALF;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH1][TAD5212_MIXER_OUT_RDAC].gain = TAD5212_MIXER_GAIN_HALF;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH2][TAD5212_MIXER_OUT_RDAC].gain = TAD5212_MIXER_GAIN_HALF;
+            break;
+
+        case TAD5212_MIXER_PRESET_MID_SIDE:
+            matrix->path[TAD5212_MIXER_IN_ASI_CH1][TAD5212_MIXER_OUT_LDAC].gain = TAD5212_MIXER_GAIN_HALF;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH2][TAD5212_MIXER_OUT_LDAC].gain = TAD5212_MIXER_GAIN_HALF;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH1][TAD5212_MIXER_OUT_RDAC].gain = TAD5212_MIXER_GAIN_HALF;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH2][TAD5212_MIXER_OUT_RDAC].gain = TAD5212_MIXER_GAIN_HALF;
+            matrix->path[TAD5212_MIXER_IN_ASI_CH2][TAD5212_MIXER_OUT_RDAC].invert = true;
+            break;
+
+        default:
+            return ESP_ERR_INVALID_ARG;
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ *  \brief Apply a balance to a matrix: the outputs of one side are attenuated, the other side is
+ *         left untouched. Paths attenuated below TAD5212_MIXER_GAIN_MIN are cut.
+ *  \param matrix Matrix to update.
+ *  \param balance Attenuation in tenths of dB, of the LDAC outputs if positive (towards right),
+ *                 of the RDAC outputs if negative (towards left).
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_mixer_matrix_balance(tad5212_mixer_matrix_t* matrix, int16_t balance)
+{
+    int32_t gain;
+    bool left;
+
+    if (matrix == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (balance == 0)
+    {
+        return ESP_OK;
+    }
+
+    for (int in = 0; in < TAD5212_MIXER_INPUTS; in++)
+    {
+        for (int out = 0; out < TAD5212_MIXER_OUTPUTS; out++)
+        {
+            tad5212_mixer_gain_t* path = &matrix->path[in][out];
+
+            left = (out == TAD5212_MIXER_OUT_LDAC || out == TAD5212_MIXER_OUT_LDAC2);
+
+            /* Only the outputs of the side moved away from */
+            if (path->gain == TAD5212_MIXER_GAIN_MUTE || left != (balance > 0))
+            {
+                continue;
+            }
+
+            gain = (int32_t)path->gain - (balance > 0 ? balance : -(int32_t)balance);
+            path->gain = (gain < TAD5212_MIXER_GAIN_MIN) ? TAD5212_MIXER_GAIN_MUTE : (int16_t)gain;
+        }
+    }
+
+    return ESP_OK;
+}
+
+
+/**
+ *  \brief Convert a matrix to the codec coefficients, one row per input.
+ *  \param matrix Matrix.
+ *  \param coeffs Pointer to store TAD5212_MIXER_INPUTS rows of coefficients.
+ *  \return ESP_OK on success, ESP_ERR_INVALID_ARG if a gain is out of bounds.
+ */
+esp_err_t tad5212_mixer_matrix_coeffs(const tad5212_mixer_matrix_t* matrix, tad5212_mixer_coeffs_t* coeffs)
+{
+    esp_err_t status;
+
+    if (matrix == NULL || coeffs == NULL)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    for (int in = 0; in < TAD5212_MIXER_INPUTS; in++)
+    {
+        const tad5212_mixer_gain_t* row = matrix->path[in];
+
+        /* a2, a1, a4, a3 are the RDAC, LDAC, RDAC2, LDAC2 coefficients of the row */
+        status = tad5212_mixer_gain_to_coeff(&row[TAD5212_MIXER_OUT_RDAC], &coeffs[in].a2.value);
+        if (status == ESP_OK)
+        {
+            status = tad5212_mixer_gain_to_coeff(&row[TAD5212_MIXER_OUT_LDAC], &coeffs[in].a1.value);
+        }
+        if (status == ESP_OK)
+        {
+            status = tad5212_mixer_gain_to_coeff(&row[TAD5212_MIXER_OUT_RDAC2], &coeffs[in].a4.value);
+        }
+        if (status == ESP_OK)
+        {
+            status = tad5212_mixer_gain_to_coeff(&row[TAD5212_MIXER_OUT_LDAC2], &coeffs[in].a3.value);
+        }
+        if (status != ESP_OK)
+        {
+            return status;
+        }
+    }
+
+    return ESP_OK;
+}
@@ -0,0 +1,107 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * ASI DIN mixer matrix of TAD5212 audio CODECs: gains in dB and presets
+ *
+ * No licence
+ */
+
+#ifndef __TAD5212_MIXER_MATRIX_H__
+#define __TAD5212_MIXER_MATRIX_H__
+
+/*** Includes **************************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#include "tad5212_mixer.h"
+
+/*** Defines **************************************************************************/
+
+/* Bounds of a gain, in tenths of dB */
+#define TAD5212_MIXER_GAIN_MAX      60          /* +6 dB, highest Q1.14 coefficient */
+#define TAD5212_MIXER_GAIN_MIN      (-720)      /* -72 dB, a few coefficient LSB */
+#define TAD5212_MIXER_GAIN_MUTE     INT16_MIN   /* Path cut */
+
+/*** Enumerations *********************************************************************/
+
+/* Mixer inputs, ASI channels received */
+typedef enum
+{
+    TAD5212_MIXER_IN_ASI_CH1 = 0,       /* Left */
+    TAD5212_MIXER_IN_ASI_CH2,           /* Right */
+    TAD5212_MIXER_INPUTS,
+}
+tad5212_mixer_input_t;
+
+/* Mixer outputs, in the register order of an input row */
+typedef enum
+{
+    TAD5212_MIXER_OUT_RDAC = 0,         /* DAC channel 2 */
+    TAD5212_MIXER_OUT_LDAC,             /* DAC channel 1 */
+    TAD5212_MIXER_OUT_RDAC2,            /* DAC channel 2, second path */
+    TAD5212_MIXER_OUT_LDAC2,            /* DAC channel 1, second path */
+    TAD5212_MIXER_OUTPUTS,
+}
+tad5212_mixer_output_t;
+
+/* Mixer presets */
+typedef enum
+{
+    TAD5212_MIXER_PRESET_STEREO = 0,    /* L -> LDAC, R -> RDAC */
+    TAD5212_MIXER_PRESET_SWAP,          /* L -> RDAC, R -> LDAC */
+    TAD5212_MIXER_PRESET_MONO,          /* (L + R) / 2 -> LDAC and RDAC */
+    TAD5212_MIXER_PRESET_MID_SIDE,      /* (L + R) / 2 -> LDAC, (L - R) / 2 -> RDAC */
+}
+tad5212_mixer_preset_t;
+
+/*** Structures ***********************************************************************/
+
+/* Path from an input to an output */
+typedef struct
+{
+    int16_t gain;           /* Gain in tenths of dB, or TAD5212_MIXER_GAIN_MUTE */
+    bool    invert;         /* Polarity inversion */
+}
+tad5212_mixer_gain_t;
+
+/* Mixer matrix */
+typedef struct
+{
+    tad5212_mixer_gain_t path[TAD5212_MIXER_INPUTS][TAD5212_MIXER_OUTPUTS];
+}
+tad5212_mixer_matrix_t;
+
+/*** Extern functions *****************************************************************/
+
+/**
+ *  \brief Build the matrix of a preset, unused paths are cut.
+ *  \param preset Preset.
+ *  \param matrix Pointer to store the matrix.
+ *  \return ESP_OK on success, ESP_ERR_INVALID_ARG if the preset is unknown.
+ */
+esp_err_t tad5212_mixer_matrix_preset(tad5212_mixer_preset_t preset, tad5212_mixer_matrix_t* matrix);
+
+
+/**
+ *  \brief Apply a balance to a matrix: the outputs of one side are attenuated, the other side is
+ *         left untouched. Paths attenuated below TAD5212_MIXER_GAIN_MIN are cut.
+ *  \param matrix Matrix to update.
+ *  \param balance Attenuation in tenths of dB, of the LDAC outputs if positive (towards right),
+ *                 of the RDAC outputs if negative (towards left).
+ *  \return ESP_OK on success, error code otherwise.
+ */
+esp_err_t tad5212_mixer_matrix_balance(tad5212_mixer_matrix_t* matrix, int16_t balance);
+
+
+/**
+ *  \brief Convert a matrix to the codec coefficients, one row per input.
+ *  \param matrix Matrix.
+ *  \param coeffs Pointer to store TAD5212_MIXER_INPUTS rows of coefficients.
+ *  \return ESP_OK on success, ESP_ERR_INVALID_ARG if a gain is out of bounds.
+ */
+esp_err_t tad5212_mixer_matrix_coeffs(const tad5212_mixer_matrix_t* matrix, tad5212_mixer_coeffs_t* coeffs);
+
+#endif /* __TAD5212_MIXER_MATRIX_H__ */
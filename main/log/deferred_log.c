@@ -0,0 +1,185 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Deferred, rate-limited logging for time critical paths
+ * 
+ * No licence
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "deferred_log.h"
+
+/*** Defines *********************************************************************/
+
+#define DEFERRED_LOG_MASK       (DEFERRED_LOG_DEPTH - 1)
+
+/*** Structures ******************************************************************/
+
+/* ring entry, the sequence number tells whether it is free or holds a line */
+typedef struct
+{
+    atomic_uint_fast32_t sequence;
+    deferred_log_site_t* site;
+    uint32_t args[2];
+    uint32_t timestamp_ms;
+}
+deferred_log_entry_t;
+
+/*** Static variables ************************************************************/
+
+static deferred_log_entry_t s_entries[DEFERRED_LOG_DEPTH];
+static atomic_uint_fast32_t s_head;         /* next entry reserved by a producer */
+static uint32_t s_tail;                     /* next entry printed, log task only */
+static atomic_uint_fast32_t s_dropped;      /* lines lost because the ring was full */
+static TaskHandle_t s_task_handle = NULL;
+
+/*** Static functions ************************************************************/
+
+/**
+ * \brief Print one queued line, unless its site printed too recently.
+ * \param entry Entry to print.
+ */
+static void deferred_log_print(deferred_log_entry_t* entry)
+{
+    deferred_log_site_t* site = entry->site;
+    char line[128];
+    int len;
+
+    if (site->printed && entry->timestamp_ms - site->last_print_ms < site->min_interval_ms)
+    {
+        site->suppressed++;
+        return;
+    }
+
+    len = snprintf(line, sizeof(line), site->format, entry->args[0], entry->args[1]);
+    if (site->suppressed > 0 && len >= 0 && len < (int)sizeof(line))
+    {
+        snprintf(line + len, sizeof(line) - len, " (+%u suppressed)", (unsigned)site->suppressed);
+    }
+    ESP_LOG_LEVEL(site->level, site->tag, "%s", line);
+
+    site->printed = true;
+    site->last_print_ms = entry->timestamp_ms;
+    site->suppressed = 0;
+}
+
+/**
+ * \brief Log task: periodically drain the ring.
+ * \param arg Unused.
+ */
+static void deferred_log_task(void* arg)
+{
+    uint32_t dropped;
+
+    for (;;)
+    {
+        deferred_log_entry_t* entry = &s_entries[s_tail & DEFERRED_LOG_MASK];
+
+        /* entry published by its producer */
+        while (atomic_load_explicit(&entry->sequence, memory_order_acquire) == s_tail + 1)
+        {
+            deferred_log_print(entry);
+
+            /* hand the entry back to the producers for the next lap */
+            atomic_store_explicit(&entry->sequence, s_tail + DEFERRED_LOG_DEPTH, memory_order_release);
+            s_tail++;
+            entry = &s_entries[s_tail & DEFERRED_LOG_MASK];
+        }
+
+        dropped = atomic_exchange_explicit(&s_dropped, 0, memory_order_relaxed);
+        if (dropped > 0)
+        {
+            ESP_LOGW(DEFERRED_LOG_TAG, "%u log lines lost", (unsigned)dropped);
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(DEFERRED_LOG_PERIOD_MS));
+    }
+}
+
+/*** Extern functions ************************************************************/
+
+/**
+ * \brief Queue a log line. Constant time, lock-free and safe from any task: the line is
+ *        formatted and printed later by a low priority task. Dropped when the ring is full.
+ * \param site Log site declared with DEFERRED_LOG_SITE.
+ * \param arg0 First argument of the format.
+ * \param arg1 Second argument of the format.
+ */
+void deferred_log_push(deferred_log_site_t* site, uint32_t arg0, uint32_t arg1)
+{
+    uint_fast32_t position = atomic_load_explicit(&s_head, memory_order_relaxed);
+    deferred_log_entry_t* entry;
+    int32_t diff;
+
+    if (s_task_handle == NULL || !site->enabled)
+    {
+        return;
+    }
+
+    for (;;)
+    {
+        entry = &s_entries[position & DEFERRED_LOG_MASK];
+        diff = (int32_t)(atomic_load_explicit(&entry->sequence, memory_order_acquire) - position);
+
+        if (diff == 0)
+        {
+            /* entry free for this lap, try to reserve it */
+            if (atomic_compare_exchange_weak_explicit(&s_head, &position, position + 1,
+                                                      memory_order_relaxed, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* ring full, the log task is behind */
+            atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+            return;
+        }
+        else
+        {
+            /* another producer took this entry */
+            position = atomic_load_explicit(&s_head, memory_order_relaxed);
+        }
+    }
+
+    entry->site = site;
+    entry->args[0] = arg0;
+    entry->args[1] = arg1;
+    entry->timestamp_ms = esp_log_timestamp();
+    atomic_store_explicit(&entry->sequence, position + 1, memory_order_release);
+}
+
+/**
+ * \brief Start the task printing the queued lines.
+ * \param priority Priority of the log task, should be low.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t deferred_log_start(uint32_t priority)
+{
+    if (s_task_handle != NULL)
+    {
+        return ESP_OK;
+    }
+
+    for (uint32_t i = 0; i < DEFERRED_LOG_DEPTH; i++)
+    {
+        atomic_store_explicit(&s_entries[i].sequence, i, memory_order_relaxed);
+    }
+    atomic_store_explicit(&s_head, 0, memory_order_relaxed);
+    s_tail = 0;
+
+    if (xTaskCreate(deferred_log_task, "DeferredLog", 3072, NULL, priority, &s_task_handle) != pdPASS)
+    {
+        ESP_LOGE(DEFERRED_LOG_TAG, "Log task creation failed");
+        return ESP_ERR_NO_MEM;
+    }
+
+    return ESP_OK;
+}
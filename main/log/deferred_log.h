@@ -0,0 +1,83 @@
+/**
+ * Written by Leny Marcolini - ESEO - 2026
+ *
+ * Deferred, rate-limited logging for time critical paths
+ * 
+ * No licence
+ */
+
+#ifndef __DEFERRED_LOG_H__
+#define __DEFERRED_LOG_H__
+
+/*** Includes ********************************************************************/
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+
+/*** Defines *********************************************************************/
+
+/* log tag */
+#define DEFERRED_LOG_TAG        "DLOG"
+
+/* entries waiting to be printed, power of 2 */
+#define DEFERRED_LOG_DEPTH      (64)
+
+/* period at which the log task drains the ring */
+#define DEFERRED_LOG_PERIOD_MS  (50)
+
+/**
+ * Declare a log site: a tag, a level, a format taking up to two 32-bit arguments and the
+ * minimum interval between two printed lines. Lines pushed within the interval are counted
+ * and the count is appended to the next printed line. Sites above LOG_LOCAL_LEVEL of the
+ * declaring file are never queued; the runtime level of the tag is only checked when printing,
+ * the esp_log lock is never taken on the pushing side.
+ */
+#define DEFERRED_LOG_SITE(name, site_tag, site_level, interval_ms, site_format)    \
+    static deferred_log_site_t name =                                               \
+    {                                                                               \
+        .tag = site_tag,                                                            \
+        .level = site_level,                                                        \
+        .enabled = ((site_level) <= LOG_LOCAL_LEVEL),                               \
+        .min_interval_ms = interval_ms,                                             \
+        .format = site_format,                                                      \
+    }
+
+/*** Structures ******************************************************************/
+
+typedef struct
+{
+    const char* tag;
+    esp_log_level_t level;
+    bool enabled;
+    uint32_t min_interval_ms;
+    const char* format;
+
+    /* owned by the log task */
+    uint32_t last_print_ms;
+    uint32_t suppressed;
+    uint8_t printed;
+}
+deferred_log_site_t;
+
+/*** Extern functions ************************************************************/
+
+/**
+ * \brief Queue a log line. Constant time, lock-free and safe from any task: the line is
+ *        formatted and printed later by a low priority task. Dropped when the ring is full.
+ * \param site Log site declared with DEFERRED_LOG_SITE.
+ * \param arg0 First argument of the format.
+ * \param arg1 Second argument of the format.
+ */
+void deferred_log_push(deferred_log_site_t* site, uint32_t arg0, uint32_t arg1);
+
+/**
+ * \brief Start the task printing the queued lines.
+ * \param priority Priority of the log task, should be low.
+ * \return ESP_OK if successful, otherwise an error code.
+ */
+esp_err_t deferred_log_start(uint32_t priority);
+
+#endif /* __DEFERRED_LOG_H__ */
@@ -13,6 +13,7 @@
 #include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "nvs.h"
 #include "nvs_flash.h"
 #include "esp_system.h"
@@ -30,7 +31,11 @@
 #include "driver/gpio.h"
 #include "driver/i2c_master.h"
 #include "codec/tad5212.h"
+#include "codec/tad5212_async.h"
+#include "codec/tad5212_eq.h"
 #include "amplifier/tpa3255.h"
+#include "audio/telemetry.h"
+#include "log/deferred_log.h"
 
 /*** Defines *******************************************************************/
 
@@ -38,9 +43,18 @@
 #define A2DP_TAG    "A2DP"
 #define AVRCP_TAG   "AVRCP"
 
-#define MAIN_TICK_DELAY_MS              10
 #define DEBUG_PRINT_DELAY_MS            500
 
+/* Control task */
+#define CONTROL_TASK_STACK_SIZE         3072
+#define CONTROL_TASK_PRIORITY           5
+
+/* Codec command worker, below the control task so a whole batch is queued before it runs */
+#define CODEC_TASK_PRIORITY             4
+
+/* Longest wait for the codecs to be muted before the amplifiers are enabled */
+#define DEPOP_MUTE_TIMEOUT_MS           200
+
 /* Pins definition */
 #define SUBWOOFER_AMP_RESET_GPIO        GPIO_NUM_33
 #define SUBWOOFER_AMP_FAULT_GPIO        GPIO_NUM_34
@@ -54,7 +68,7 @@
 #define I2C0_SCL_GPIO                   GPIO_NUM_22     /* GPIO number for I2C SCL */
 
 /* I2C configuration */
-#define I2C0_FREQUENCY                  100000          /* 100kHz I2C frequency */
+#define I2C0_FREQUENCY                  TAD5212_I2C_SPEED_FAST_PLUS    /* Highest I2C frequency, lowered per codec if unreliable */
 #define I2C0_PORT                       I2C_NUM_0       /* I2C port number */
 
 /* Codec I2C addresses */
@@ -75,12 +89,24 @@ static tad5212_handle_t subwoofer_codec;
 /* TAD5212 for 2-way speakers */
 static tad5212_handle_t speakers_codec;
 
+/* Both codecs, written together through the command queue */
+static tad5212_handle_t* const codecs[] = { &subwoofer_codec, &speakers_codec };
+#define CODEC_COUNT     (sizeof(codecs) / sizeof(codecs[0]))
+
 /* TPA3255 for subwoofer */
 static tpa3255_device_t subwoofer_amplifier;
 
 /* TPA3255 for speakers */
 static tpa3255_device_t speaker_amplifier;
 
+/* Task applying volume and audio state changes */
+static TaskHandle_t control_task_handle = NULL;
+
+/* De-pop mute applied by the codec worker, and its status */
+static SemaphoreHandle_t depop_mute_done = NULL;
+static StaticSemaphore_t depop_mute_done_buffer;
+static esp_err_t depop_mute_status = ESP_OK;
+
 /*** Enumerations *********************************************************************/
 
 /* event for stack up */
@@ -100,8 +126,168 @@ static void bt_app_gap_cb(esp_bt_gap_cb_event_t event, esp_bt_gap_cb_param_t *pa
 /* handler for bluetooth stack enabled events */
 static void bt_av_hdl_stack_evt(uint16_t event, void *p_param);
 
+/* Control task function */
+static void control_task(void* arg);
+
+/* Completion of the de-pop mute, called by the codec worker */
+static void depop_mute_cb(esp_err_t status, void* arg);
+
 /*** Static functions *******************************************************************/
 
+/**
+ * \brief Completion of the de-pop mute, called by the codec worker once the mute is written.
+ * \param status Status of the volume change.
+ * \param arg Unused.
+ */
+static void depop_mute_cb(esp_err_t status, void* arg)
+{
+    depop_mute_status = status;
+    xSemaphoreGive(depop_mute_done);
+}
+
+/**
+ * \brief Control task: applies volume, audio state and sample rate changes to the codecs and
+ *        amplifiers as soon as they are notified, and sleeps otherwise.
+ * \param arg Unused.
+ */
+static void control_task(void* arg)
+{
+    uint8_t previous_volume = 0;
+    bt_audio_state_t previous_audio_state = BT_AUDIO_STOPPED;
+    uint32_t events = 0;
+
+    #ifdef TAD5212_DEBUG
+    TickType_t last_debug_tick = xTaskGetTickCount();
+    #endif
+
+    for (;;)
+    {
+        #ifdef TAD5212_DEBUG
+        if (xTaskNotifyWait(0, UINT32_MAX, &events, pdMS_TO_TICKS(DEBUG_PRINT_DELAY_MS)) == pdFALSE)
+        {
+            events = 0;
+        }
+        if (xTaskGetTickCount() - last_debug_tick >= pdMS_TO_TICKS(DEBUG_PRINT_DELAY_MS))
+        {
+            last_debug_tick = xTaskGetTickCount();
+            tad5212_async_call(codecs, CODEC_COUNT, tad5212_dac_status, NULL, NULL);
+        }
+        #else
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
+        #endif
+
+        if (events == 0)
+        {
+            continue;
+        }
+
+        // Check amplifiers status
+        /*
+        tpa3255_fault_flags_t fault_status = tpa3255_gpio_get_status(&subwoofer_amplifier);
+
+        switch (fault_status)
+        {
+            case OTE_OLP_UVP_FAULT:
+                ESP_LOGE(TPA3255_TAG, "SUBWOOFER AMP Fault: Over Temperature/Over Load/Under Voltage Protection");
+                break; 
+
+            case OLP_UVP_FAULT:
+                ESP_LOGE(TPA3255_TAG, "SUBWOOFER AMP Fault: Over Load/Under Voltage Protection");
+                break;
+
+            case OTW_WARNING:
+                bt_volume_set_by_local_host(0x3F); // Reduce volume to 50%
+                previous_volume = 0x3F; 
+                ESP_LOGW(TPA3255_TAG, "SUBWOOFER AMP Warning: Over Temperature/Clipping - Volume Reduced to 50%%");
+                break;
+
+            default:
+                break;
+        }
+
+        fault_status = tpa3255_gpio_get_status(&speaker_amplifier);
+
+        switch (fault_status)
+        {
+            case OTE_OLP_UVP_FAULT:
+                ESP_LOGE(TPA3255_TAG, "SPEAKER AMP Fault: Over Temperature/Over Load/Under Voltage Protection");
+                break; 
+
+            case OLP_UVP_FAULT:
+                ESP_LOGE(TPA3255_TAG, "SPEAKER AMP Fault: Over Load/Under Voltage Protection");
+                break;
+
+            case OTW_WARNING:
+                bt_volume_set_by_local_host(0x3F); // Reduce volume to 50%
+                previous_volume = 0x3F; 
+                ESP_LOGW(TPA3255_TAG, "SPEAKER AMP Warning: Over Temperature/Clipping - Volume Reduced to 50%%");
+                break;
+
+            default:
+                break;
+        }
+*/
+
+        /* Crossover and EQ filters follow the sample rate of the stream, before it starts playing */
+        if (events & BT_APP_NOTIFY_SAMPLE_RATE)
+        {
+            tad5212_async_set_sample_rate(codecs, CODEC_COUNT, bt_app_get_sample_rate(), NULL, NULL);
+            tad5212_async_call(codecs, CODEC_COUNT, tad5212_eq_load, NULL, NULL);
+        }
+
+        uint8_t volume = bt_app_get_volume();
+        bt_audio_state_t audio_state = bt_app_get_audio_state();
+
+        if (audio_state == BT_AUDIO_PLAYING)
+        {
+            if (volume != previous_volume)
+            {
+                uint16_t normalized_vol = volume * 100 / 0x7f;
+                tad5212_async_set_volume(codecs, CODEC_COUNT, TAD5212_CHANNEL_BOTH, normalized_vol, NULL, NULL);
+                previous_volume = volume;
+            }
+        }
+
+        /* De-pop mechanism */
+        if (audio_state != previous_audio_state)
+        {
+            if (audio_state == BT_AUDIO_PLAYING) 
+            {
+                // Force low volume on reset change to avoid replicating audible artefact
+                uint16_t normalized_vol = volume * 100 / 0x7f;
+
+                // Amplifiers stay in reset until the codecs are muted: nothing else queues a volume
+                // change meanwhile, so the mute can not be replaced by a later one
+                xSemaphoreTake(depop_mute_done, 0);
+                if (tad5212_async_set_volume(codecs, CODEC_COUNT, TAD5212_CHANNEL_BOTH, 0, depop_mute_cb, NULL) != ESP_OK ||
+                    xSemaphoreTake(depop_mute_done, pdMS_TO_TICKS(DEPOP_MUTE_TIMEOUT_MS)) != pdTRUE)
+                {
+                    ESP_LOGW(MAIN_TAG, "De-pop mute not applied in time");
+                }
+                else if (depop_mute_status != ESP_OK)
+                {
+                    ESP_LOGW(MAIN_TAG, "De-pop mute failed: %s", esp_err_to_name(depop_mute_status));
+                }
+
+                // Wait 50ms for audio signal stabilization 
+                vTaskDelay(pdMS_TO_TICKS(50));
+
+                // Enable amplifier
+                tpa3255_gpio_set_reset(&subwoofer_amplifier, false);
+                tpa3255_gpio_set_reset(&speaker_amplifier, false);
+
+                // Wait 50ms for internal circuit stabilization
+                vTaskDelay(pdMS_TO_TICKS(50));
+
+                // Play sound at user volume
+                tad5212_async_set_volume(codecs, CODEC_COUNT, TAD5212_CHANNEL_BOTH, normalized_vol, NULL, NULL);
+                previous_volume = volume;
+            }
+            previous_audio_state = audio_state;
+        }
+    }
+}
+
 static char *bda2str(uint8_t * bda, char *str, size_t size)
 {
     if (bda == NULL || str == NULL || size < 18) {
@@ -317,8 +503,14 @@ void app_main(void)
     esp_bt_gap_set_pin(pin_type, 4, pin_code);
 
     ESP_LOGI(BT_AV_TAG, "Own address:[%s]", bda2str((uint8_t *)esp_bt_dev_get_address(), bda_str, sizeof(bda_str)));
+
+    /* logs of the audio data path are printed by a low priority task */
+    deferred_log_start(tskIDLE_PRIORITY + 1);
     bt_app_task_start_up();
 
+    /* periodic summary of the audio pipeline statistics, printed by a low priority task */
+    telemetry_start(CONFIG_EXAMPLE_A2DP_SINK_TELEMETRY_PERIOD_MS, tskIDLE_PRIORITY + 1);
+
     /* bluetooth device name, connection mode and profile set up */
     bt_app_work_dispatch(bt_av_hdl_stack_evt, BT_APP_EVT_STACK_UP, NULL, 0, NULL);
 
@@ -367,7 +559,7 @@ void app_main(void)
     }
 
     /* Initialize TAD5212 Subwoofer codec */
-    if (tad5212_init(&subwoofer_codec, I2C0_bus_handle, TAD5212_I2C_ADDRESS_SUBWOOFER, TAD5212_CONFIG_STEREO) != ESP_OK) 
+    if (tad5212_init(&subwoofer_codec, I2C0_bus_handle, TAD5212_I2C_ADDRESS_SUBWOOFER, TAD5212_CONFIG_STEREO, I2C0_FREQUENCY) != ESP_OK) 
     {
         ESP_LOGE(BT_AV_TAG, "Failed to initialize Subwoofer codec");
     }
@@ -377,7 +569,7 @@ void app_main(void)
     }
 
     /* Initialize TAD5212 Speakers codec */
-    if (tad5212_init(&speakers_codec, I2C0_bus_handle, TAD5212_I2C_ADDRESS_SPEAKERS, TAD5212_CONFIG_STEREO) != ESP_OK) 
+    if (tad5212_init(&speakers_codec, I2C0_bus_handle, TAD5212_I2C_ADDRESS_SPEAKERS, TAD5212_CONFIG_STEREO, I2C0_FREQUENCY) != ESP_OK) 
     {
         ESP_LOGE(BT_AV_TAG, "Failed to initialize Speakers codec");
     }
@@ -386,112 +578,35 @@ void app_main(void)
         ESP_LOGI(BT_AV_TAG, "Speakers codec initialized successfully");
     }
 
-    while(1) 
-    {
-        static uint8_t previous_volume = 0;
-        static bt_audio_state_t previous_audio_state = BT_AUDIO_STOPPED;
+    /* Include the codecs in the delay reported to the source, the slowest one sets the pace */
+    uint32_t subwoofer_delay = 0;
+    uint32_t speakers_delay = 0;
+    tad5212_get_group_delay_frames(&subwoofer_codec, &subwoofer_delay);
+    tad5212_get_group_delay_frames(&speakers_codec, &speakers_delay);
+    bt_audio_set_output_delay_frames(subwoofer_delay > speakers_delay ? subwoofer_delay : speakers_delay);
 
-        #ifdef TAD5212_DEBUG
-        static uint32_t debug_tick_count = 0;
-        if (debug_tick_count < DEBUG_PRINT_DELAY_MS / MAIN_TICK_DELAY_MS)
-            debug_tick_count++;
-        else
-        {
-            debug_tick_count = 0;
-            tad5212_dac_status(&subwoofer_codec);
-            tad5212_dac_status(&speakers_codec);
-        }
-        #endif
-
-        // Check amplifiers status
-        /*
-        tpa3255_fault_flags_t fault_status = tpa3255_gpio_get_status(&subwoofer_amplifier);
-
-        switch (fault_status)
-        {
-            case OTE_OLP_UVP_FAULT:
-                ESP_LOGE(TPA3255_TAG, "SUBWOOFER AMP Fault: Over Temperature/Over Load/Under Voltage Protection");
-                break; 
-
-            case OLP_UVP_FAULT:
-                ESP_LOGE(TPA3255_TAG, "SUBWOOFER AMP Fault: Over Load/Under Voltage Protection");
-                break;
-
-            case OTW_WARNING:
-                bt_volume_set_by_local_host(0x3F); // Reduce volume to 50%
-                previous_volume = 0x3F; 
-                ESP_LOGW(TPA3255_TAG, "SUBWOOFER AMP Warning: Over Temperature/Clipping - Volume Reduced to 50%%");
-                break;
-
-            default:
-                break;
-        }
-
-        fault_status = tpa3255_gpio_get_status(&speaker_amplifier);
-
-        switch (fault_status)
-        {
-            case OTE_OLP_UVP_FAULT:
-                ESP_LOGE(TPA3255_TAG, "SPEAKER AMP Fault: Over Temperature/Over Load/Under Voltage Protection");
-                break; 
-
-            case OLP_UVP_FAULT:
-                ESP_LOGE(TPA3255_TAG, "SPEAKER AMP Fault: Over Load/Under Voltage Protection");
-                break;
-
-            case OTW_WARNING:
-                bt_volume_set_by_local_host(0x3F); // Reduce volume to 50%
-                previous_volume = 0x3F; 
-                ESP_LOGW(TPA3255_TAG, "SPEAKER AMP Warning: Over Temperature/Clipping - Volume Reduced to 50%%");
-                break;
-
-            default:
-                break;
-        }
-*/
-        /* Polling on volume change */
-        uint8_t volume = bt_app_get_volume();
-
-        /* Polling on audio state change */
-        bt_audio_state_t audio_state = bt_app_get_audio_state();
-
-        if (audio_state == BT_AUDIO_PLAYING)
-        {
-            if (volume != previous_volume)
-            {
-                uint16_t normalized_vol = volume * 100 / 0x7f;
-                tad5212_set_volume(&subwoofer_codec, TAD5212_CHANNEL_BOTH, normalized_vol);
-                tad5212_set_volume(&speakers_codec, TAD5212_CHANNEL_BOTH, normalized_vol);
-                previous_volume = volume;
-            }
-        }
-
-        /* De-pop mechanism */
-        if (audio_state != previous_audio_state)
-        {
-            if (audio_state == BT_AUDIO_PLAYING) 
-            {
-                // Force low volume on reset change to avoid replicating audible artefact
-                uint16_t normalized_vol = volume * 100 / 0x7f;
-                tad5212_set_volume(&subwoofer_codec, TAD5212_CHANNEL_BOTH, 0);
-                tad5212_set_volume(&speakers_codec, TAD5212_CHANNEL_BOTH, 0);
-
-                // Wait 50ms for audio signal stabilization 
-                vTaskDelay(pdMS_TO_TICKS(50));
-
-                // Enable amplifier
-                tpa3255_gpio_set_reset(&subwoofer_amplifier, false);
-                tpa3255_gpio_set_reset(&speaker_amplifier, false);
+    /* From now on the codecs are only accessed through the command queue */
+    if (tad5212_async_start(CODEC_TASK_PRIORITY) != ESP_OK)
+    {
+        ESP_LOGE(MAIN_TAG, "Codec command queue start failed");
+        return;
+    }
 
-                // Wait 50ms for internal circuit stabilization
-                vTaskDelay(pdMS_TO_TICKS(50));
+    /* EQ profiles stored in NVS, loaded in the codecs by the control task */
+    if (tad5212_eq_init() != ESP_OK)
+    {
+        ESP_LOGE(MAIN_TAG, "EQ profiles load failed");
+    }
 
-                // Play sound at user volume
-                tad5212_set_volume(&subwoofer_codec, TAD5212_CHANNEL_BOTH, normalized_vol);
-                tad5212_set_volume(&speakers_codec, TAD5212_CHANNEL_BOTH, normalized_vol);
-            }
-            previous_audio_state = audio_state;
-        }
-        vTaskDelay(pdMS_TO_TICKS(MAIN_TICK_DELAY_MS));
+    /* Volume and audio state changes are applied by the control task */
+    depop_mute_done = xSemaphoreCreateBinaryStatic(&depop_mute_done_buffer);
+    if (xTaskCreate(control_task, "ControlTask", CONTROL_TASK_STACK_SIZE, NULL, CONTROL_TASK_PRIORITY, &control_task_handle) != pdPASS)
+    {
+        ESP_LOGE(MAIN_TAG, "Control task creation failed");
+        return;
     }
+    bt_app_av_set_control_task(control_task_handle);
+
+    /* Apply the state reached before the task was listening */
+    xTaskNotify(control_task_handle, BT_APP_NOTIFY_VOLUME | BT_APP_NOTIFY_AUDIO_STATE | BT_APP_NOTIFY_SAMPLE_RATE, eSetBits);
 }